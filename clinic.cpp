@@ -1,35 +1,159 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _WIN32
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // SRWLOCK & CONDITION_VARIABLE
+#endif
+#include <winsock2.h> // harus sebelum windows.h
 #include <windows.h>
 #include <conio.h>
+#endif
 #include <time.h>
 #include <ctype.h>
-
-#define TABLE_SIZE 100
+#include <stdint.h>
+#include <stdarg.h>
+#include <limits.h>
+#include <math.h>
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h> // pencarian delimiter CSV
+#endif
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <termios.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <signal.h>
+#endif
+
+// Tipe lock & socket per platform, fungsi pembungkusnya ada di [PLATFORM]
+#ifdef _WIN32
+typedef SRWLOCK mutex_t;
+typedef SRWLOCK rwlock_t;
+typedef CONDITION_VARIABLE cond_t;
+typedef SOCKET socket_t;
+#define NET_INVALID INVALID_SOCKET
+#define NULL_DEVICE "NUL"
+#else
+typedef pthread_mutex_t mutex_t;
+typedef pthread_rwlock_t rwlock_t;
+typedef pthread_cond_t cond_t;
+typedef int socket_t;
+#define NET_INVALID (-1)
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define TABLE_INITIAL_CAPACITY 64 // harus pangkat dua
+#define TABLE_MAX_LOAD_NUM 7        // resize ketika terisi > 7/8
+#define TABLE_MAX_LOAD_DEN 8
 #define ROLE_CLIENT 0
 #define ROLE_ADMIN 1
 #define ROLE_DOCTOR 2
-#define ALPHABET_SIZE 26
+#define TRIE_LABEL_MAX 19 // username maksimal 19 karakter, label edge tidak lebih panjang
+#define TRIE_TOP_K 10     // jumlah dokter yang ditampilkan pada pencarian prefix
+#define MIN_YEAR 1970 // rentang tahun reservasi yang diterima,
+#define MAX_YEAR 5000 // menit sejak 1970 masih muat di int
+#define MINUTES_PER_DAY 1440
+#define SLOT_MINUTES 15 // granularity kalender dokter
+#define SLOTS_PER_DAY (MINUTES_PER_DAY / SLOT_MINUTES)
+#define SLOT_WORDS ((SLOTS_PER_DAY + 63) / 64)
 // ======================= [DATA STRUCTURES] =======================
-#define MAX_HEAP 1000
+#define AVL_MAX_HEIGHT 64              // cukup untuk AVL dengan > 10^12 node
+#define AVL_UNIQUE 0                   // insert_avl: tolak key yang sudah ada
+#define AVL_ALLOW_DUPLICATES 1         // insert_avl: simpan duplikat key
+#define REPORT_BUFFER_BYTES (16 * 1024) // buffer output laporan
+#define JOURNAL_SYNC_BATCH 8            // fsync setiap 8 event...
+#define JOURNAL_SYNC_INTERVAL 1         // ...atau jika sync terakhir > 1 detik lalu
+#define JOURNAL_COMPACT_THRESHOLD 1000 // compaction setelah 1000 event
+#define RATING_COMPACT_THRESHOLD 1000  // snapshot rating setelah 1000 rating baru
+#define RATING_BUCKET_DAYS 90          // ring bucket harian rating per dokter
+#define RATING_WINDOW_DAYS 30          // jendela "30 hari terakhir" di Rating Summary
+#define RATING_HALF_LIFE_DAYS 14.0     // bobot rating turun setengah setiap 14 hari
+#define STORE_SCAN_BLOCK 1024          // baris per blok kernel scan analitik
+#define CLINIC_OPEN_HOURS 8            // jam praktik per hari, dasar utilisasi dokter
+#define ANALYTICS_MAX_DAYS 366         // rentang maksimal laporan analitik
+#define PERSIST_RING_SIZE 4096          // slot ring mutasi, harus pangkat dua
+#define PERSIST_IDLE_MS 2               // tidur thread persistence saat ring kosong
+#define LOADER_MAX_CHUNKS 64            // batas chunk paralel per file CSV
+#define LOADER_MIN_CHUNK_BYTES (1 << 20) // file kecil tidak perlu dipecah
+#define POOL_SLAB_BYTES (64 * 1024)     // ukuran satu slab memory pool
+#define ARENA_BLOCK_BYTES (64 * 1024)   // ukuran block scratch arena
+#define JSON_MAX_FIELDS 16              // field per baris request batch
+#define BATCH_LINE_BYTES 4096           // panjang maksimum satu baris JSONL
+#define USER_LOCK_STRIPES 64            // lock per user (di-stripe dengan hash username)
+#define SERVER_DEFAULT_PORT 7070
+#define SERVER_QUEUE_SIZE 64 // koneksi yang menunggu worker
+#define SNAPSHOT_PATH "clinic.snap"
+#define SNAPSHOT_MAGIC "CLINSNAP"
+#define SNAPSHOT_VERSION 1 // naikkan setiap layout record berubah
+#define ARCHIVE_DIR "archive" // segment reservasi per bulan yang sudah lewat
+#define GEN_USERS_PER_DOCTOR 100 // --gen-data: rasio user per dokter...
+#define GEN_MAX_DOCTORS 5000     // ...dengan batas jumlah dokter
+#define GEN_ZIPF_EXPONENT 1.1    // kemiringan popularitas dokter
+#define GEN_RATING_DAYS 365      // rating tersebar di setahun terakhir
+#define BENCH_LOOKUPS 1000000     // operasi per putaran benchmark find_user/insert_avl
+#define BENCH_MISSING_NAMES 4096  // harus pangkat dua
+#define BENCH_REPORT_LIMIT 100
+#define BENCH_RESULTS_PATH "bench_results.csv"
+
+#define METRICS_PATH "metrics.csv"
+#define METRICS_INTERVAL_SECONDS 60 // metrics.csv ditambah paling sering sekali per menit
+#define METRIC_BUCKETS 592          // 16 + 36 pangkat dua x 16 sub-bucket, sampai ~18 menit
+#define METRIC_SAMPLE_MASK 63       // operasi < 1 us: latency diukur 1 dari 64 panggilan
+
+// Operasi yang diukur (lihat [METRICS])
+#define METRIC_FIND_USER 0
+#define METRIC_INSERT_AVL 1
+#define METRIC_SAVE_USERS 2
+#define METRIC_SAVE_RESERVATIONS 3
+#define METRIC_SAVE_SNAPSHOT 4
+#define METRIC_COMPACT_JOURNAL 5
+#define METRIC_COMPACT_RATINGS 6
+#define METRIC_LOAD_USERS 7
+#define METRIC_LOAD_RESERVATIONS 8
+#define METRIC_LOAD_RATINGS 9
+#define METRIC_REPORT 10
+#define METRIC_ANALYTICS 11
+#define METRIC_LOAD_ARCHIVE 12
+#define METRIC_RANGE_QUERY 13
+#define METRIC_REQUEST 14 // + index op di batch_ops
+#define METRIC_COUNT (METRIC_REQUEST + 9)
+
+// Hasil operasi inti (lihat [OPERATIONS])
+#define OP_OK 0
+#define OP_INVALID 1     // input tidak valid
+#define OP_NOT_FOUND 2   // user, dokter atau reservasi tidak ada
+#define OP_EXISTS 3      // username sudah dipakai
+#define OP_UNAVAILABLE 4 // dokter sedang tidak tersedia
+#define OP_SLOT_TAKEN 5  // slot dokter sudah terisi
+#define OP_DUPLICATE 6   // reservasi yang sama sudah ada
+#define OP_FORBIDDEN 7   // belum login / role tidak sesuai
+#define OP_NO_MEMORY 8
+#define OP_ARCHIVED 9 // bulan sudah diarsipkan, reservasinya tidak bisa diubah
 
 // Node untuk menyimpan data reservasi
-//  yang akan disimpan dalam queue
+//  yang disimpan di AVL milik pasien dan AVL jadwal dokter
 
 typedef struct reservation_node
 {
-    char date[20];
-    char time[10];
-    char doctor[50];
+    int when;      // key waktu: menit sejak 1970-01-01 00:00 (lihat make_when)
+    int doctor_id;  // id dokter di doctor_index (nama di-intern)
+    int patient_id; // id pasien di user_index (lihat user_name)
     char notes[100];
-    struct reservation_node *next;
-    char patient_username[20];
+    int store_row;    // baris di reservation_store, -1 = tidak tercatat
+    int snapshot_row; // baris di clinic.snap yang sedang dipakai, -1 = dibuat setelah startup
 } ReservationNode;
 
 // Struktur untuk menyimpan data user
 // yang akan disimpan dalam hash table
-// dengan chaining untuk mengatasi collision (linked list)
 typedef struct user
 {
     char username[20];
@@ -38,749 +162,6307 @@ typedef struct user
     int available; // 0 = not available, 1 = available
     int total_rating;
     int rating_count;
-    ReservationNode *reservations_front; // queue front
-    ReservationNode *reservations_rear;  // queue rear
-    struct user *next;
+    int rating_hist[5]; // jumlah rating 1..5 bintang
+    struct rating_days *rating_days; // bucket harian, NULL sampai ada rating bertanggal
+    int id;                          // id padat, index di user_index.by_id
+    struct avl_node *reservations; // AVL terurut waktu, milik user ini
 } User;
 
+// Hash table open addressing (Robin Hood probing).
+// Hash disimpan di slot supaya probing cukup membandingkan integer
+// dan strcmp hanya dilakukan ketika hash sama persis.
+typedef struct
+{
+    unsigned int hash;
+    User *user; // NULL = slot kosong
+} UserSlot;
+
 typedef struct
 {
-    User *table[TABLE_SIZE];
+    UserSlot *slots;
+    int capacity; // selalu pangkat dua, 0 = belum dialokasikan
+    int count;
 } hash_table;
 
-// Struct untuk heap
-typedef struct heap_node
+// Histogram rating satu hari
+typedef struct
 {
-    ReservationNode *res; // Pointer to reservation node
-} HeapNode;
+    int day; // hari sejak 1970-01-01, -1 = kosong
+    int hist[5];
+} RatingBucket;
 
-typedef struct ReservationHeap
+// Ring bucket harian per dokter: hari d ada di bucket[d % RATING_BUCKET_DAYS]
+// dan menggantikan hari lama yang jatuh di posisi yang sama
+typedef struct rating_days
 {
-    HeapNode *data[MAX_HEAP];
-    int size;
-} ReservationHeap;
+    RatingBucket bucket[RATING_BUCKET_DAYS];
+} RatingDays;
+
+// Hasil query jendela waktu
+typedef struct
+{
+    int count;
+    float average; // -1 = tidak ada rating
+    int hist[5];
+} RatingWindow;
 
-// Struct untuk Tries
+// Satu baris Rating Summary
+typedef struct
+{
+    User *doctor;
+    RatingWindow window;
+    float decayed; // -1 = tidak ada rating di ring
+    float weight;  // jumlah bobot rating setelah decay
+} RatingSummaryRow;
+
+// Node radix tree nama dokter. Edge dikompres: label menyimpan potongan
+// key (byte apa saja, lowercase), children urut berdasarkan byte pertama label
 typedef struct trie_node
 {
-    struct trie_node *children[ALPHABET_SIZE];
-    int is_end_of_word; //
-    char username[20];  //
+    struct trie_node **children;
+    User *doctor;   // != NULL jika ada nama dokter yang berakhir di node ini
+    float rating;   // rata-rata rating doctor, -1 = belum ada rating
+    float best;     // rating tertinggi di subtree, untuk pruning top-K
+    unsigned short child_count;
+    unsigned short child_cap;
+    unsigned char label_len;
+    char label[TRIE_LABEL_MAX];
 } TrieNode;
 
+// Entry heap top-K: subtree (key = best) atau dokter (key = rating)
+typedef struct
+{
+    float key;
+    TrieNode *node;
+    int terminal;
+} TrieHeapItem;
+
 typedef struct avl_node
 {
     struct avl_node *left;
     struct avl_node *right;
     int height;
+    int size;             // jumlah node di subtree (untuk pilih urutan ke-k)
     ReservationNode *res; // Pointer to reservation node
 } AVLNode;
 
-TrieNode *trie_root = NULL;
+// Cursor in-order untuk AVL dengan stack eksplisit.
+// Puncak stack adalah node yang sedang ditunjuk
+typedef struct
+{
+    AVLNode *stack[AVL_MAX_HEIGHT];
+    int depth;
+} AVLCursor;
 
-// ======================= [UTILITY FUNCTIONS] =======================
-// Fungsi untuk membuat hash dari username
-// Menggunakan metode hash sederhana dengan perkalian
-int hash_function(const char *username)
+// Min-heap implisit (array) berisi cursor jadwal dokter,
+// diurutkan berdasarkan reservasi yang sedang ditunjuk tiap cursor
+typedef struct ReservationHeap
 {
-    int hash = 0;
-    for (int i = 0; username[i]; i++)
-    {
-        hash = (hash * 31 + username[i]) % TABLE_SIZE;
-    }
-    return hash;
-}
+    AVLCursor **data;
+    int size;
+} ReservationHeap;
 
-void swap_heap_nodes(HeapNode **a, HeapNode **b)
+// Writer dengan buffer sendiri supaya laporan besar tidak
+// memanggil stdio untuk setiap baris
+typedef struct
 {
-    HeapNode *temp = *a;
-    *a = *b;
-    *b = temp;
-}
+    FILE *out;
+    size_t len;
+    char buf[REPORT_BUFFER_BYTES];
+} BufferedWriter;
 
-int compare_reservations(ReservationNode *a, ReservationNode *b)
+// Bitmap slot terisi untuk satu hari seorang dokter (bit = slot 15 menit)
+typedef struct
 {
-    int cmp = strcmp(a->date, b->date);
-    if (cmp == 0)
-        cmp = strcmp(a->time, b->time);
-    return cmp;
-}
+    int day; // hari sejak 1970-01-01, -1 = entry kosong
+    uint64_t used[SLOT_WORDS];
+} DaySlots;
 
-void heapify_up(ReservationHeap *heap, int idx)
+// Kalender per dokter: hari -> bitmap, open addressing linear probing.
+// Hari baru dialokasikan saat slot pertamanya terisi
+typedef struct
 {
-    if (idx == 0)
-        return;
-    int parent = (idx - 1) / 2;
-    if (compare_reservations(heap->data[idx]->res, heap->data[parent]->res) < 0)
-    {
-        swap_heap_nodes(&heap->data[idx], &heap->data[parent]);
-        heapify_up(heap, parent);
-    }
-}
+    DaySlots *days;
+    int capacity; // selalu pangkat dua, 0 = belum dialokasikan
+    int count;
+} SlotCalendar;
+
+// Jadwal satu dokter: AVL berisi semua reservasi ke dokter tersebut,
+// selalu terurut sehingga view dokter tidak perlu scan semua user
+typedef struct doctor_schedule
+{
+    char doctor[50];
+    unsigned int hash;
+    int id; // id padat 0..count-1, disimpan di ReservationNode
+    AVLNode *appointments;
+    SlotCalendar calendar; // slot terisi, sinkron dengan appointments
+    mutex_t lock;          // melindungi appointments & calendar
+    int snapshot_pending;  // reservasi dari clinic.snap belum dimasukkan (snapshot_fill_schedule)
+} DoctorSchedule;
+
+// Index sekunder nama dokter -> jadwal (open addressing, linear probing)
+// sekaligus tabel intern: by_id[id] memberi jadwal/nama tanpa hashing
+typedef struct
+{
+    DoctorSchedule **slots;
+    int capacity; // selalu pangkat dua
+    int count;
+    DoctorSchedule **by_id;
+    int by_id_capacity;
+} DoctorIndex;
+
+// Tabel intern user: by_id[id] memberi User tanpa hashing username.
+// Id tidak pernah dipakai ulang; slot user yang dihapus jadi NULL
+typedef struct
+{
+    User **by_id;
+    int count; // id berikutnya
+    int capacity;
+} UserIndex;
+
+// Salinan kolom semua reservasi untuk laporan analitik (structure of
+// arrays): kernel scan hanya membaca array int yang padat, tanpa pointer
+// chasing ke AVL. Hapus baris = swap-remove, node[] untuk memperbaiki
+// store_row reservasi yang dipindah. by_time berisi baris yang sama
+// terurut (waktu, dokter, pasien) untuk query rentang waktu
+typedef struct
+{
+    int *when;
+    int *doctor_id;
+    int *patient_id;
+    ReservationNode **node;
+    int count;
+    int capacity;
+    AVLNode *by_time;
+    mutex_t lock;
+} ReservationStore;
+
+// Write-ahead log untuk perubahan reservasi (create/cancel/hapus user)
+// Setiap event diberi nomor urut; snapshot mencatat nomor terakhir
+// yang sudah tercakup sehingga replay bisa melewati event lama
+typedef struct
+{
+    FILE *file;
+    const char *path;
+    const char *snapshot_path;
+    long long seq;          // nomor event terakhir (di-increment atomik oleh producer)
+    long long snapshot_seq; // nomor event yang sudah masuk snapshot
+    int unsynced;           // event yang belum di-fsync
+    int since_snapshot;     // event sejak compaction terakhir
+    time_t last_sync;
+} Journal;
+
+// Agregat rating per dokter (total, count, histogram) disimpan sebagai
+// snapshot; ratings.csv hanya berisi rating sejak snapshot terakhir dengan
+// format "<seq>,doctor,rating" sehingga startup sebanding jumlah dokter
+typedef struct
+{
+    const char *path;          // log append
+    const char *snapshot_path; // agregat per dokter + #rating_seq
+    long long seq;             // nomor rating terakhir (di-increment atomik)
+    long long snapshot_seq;    // nomor rating yang sudah masuk snapshot
+    int since_snapshot;        // rating di log sejak snapshot terakhir
+} RatingLog;
+
+// Reservasi bulan yang sudah lewat disimpan per bulan di
+// archive/reservations-YYYY-MM.csv dan hanya dimuat saat riwayat diminta.
+// Satu bulan selalu utuh: seluruhnya di disk atau seluruhnya resident
+typedef struct
+{
+    int month;  // tahun * 12 + bulan - 1 (lihat month_of)
+    int rows;   // jumlah reservasi di segment
+    int loaded; // sedang resident, dibuang lagi saat compaction berikutnya
+} ArchiveMonth;
 
-void heapify_down(ReservationHeap *heap, int idx)
+typedef struct
 {
-    int smallest = idx;
-    int left = 2 * idx + 1;
-    int right = 2 * idx + 2;
+    const char *dir;
+    int cutoff; // key waktu awal bulan resident pertama; sebelum ini = arsip
+    ArchiveMonth *months; // urut bulan
+    int count;
+    int capacity;
+    char (*purged)[20]; // user yang dihapus sejak compaction terakhir: barisnya
+    int purged_count;   // dilewati saat segment dimuat, dibuang saat compaction
+    int purged_capacity;
+} ReservationArchive;
+
+// Format clinic.snap: header lalu section array record berukuran tetap.
+// Semua referensi berupa index ke section lain (bukan pointer), sehingga
+// file bisa di-mmap dan record dibaca langsung. Byte order & padding
+// mengikuti mesin penulis; version/header_size yang beda = file diabaikan
+typedef struct
+{
+    int64_t size;  // -1 = file tidak ada
+    int64_t mtime; // detik
+} FileStamp;
 
-    if (left < heap->size &&
-        compare_reservations(heap->data[left]->res, heap->data[smallest]->res) < 0)
-        smallest = left;
+typedef struct
+{
+    char magic[8]; // SNAPSHOT_MAGIC tanpa '\0'
+    uint32_t version;
+    uint32_t header_size;
+    uint64_t file_size;
+    int64_t journal_seq;         // event journal terakhir yang sudah tercakup
+    int64_t rating_seq;          // rating terakhir yang sudah tercakup
+    int64_t rating_snapshot_seq; // #rating_seq di rating_totals.csv saat ditulis
+    int64_t users_csv_size;      // baris users.csv setelah offset ini = registrasi baru
+    FileStamp reservations_csv;  // harus sama persis, jika tidak snapshot basi
+    FileStamp rating_totals_csv;
+    int32_t user_count;
+    int32_t reservation_count;
+    int32_t doctor_count; // = doctor_index.count, id dokter = index
+    int32_t doctor_user_count;
+    int32_t days_count;
+    uint32_t index_capacity; // pangkat dua
+    uint64_t users_offset;        // SnapshotUser[user_count]
+    uint64_t reservations_offset; // SnapshotReservation[reservation_count], urut per pasien
+    uint64_t doctors_offset;      // SnapshotDoctor[doctor_count]
+    uint64_t by_doctor_offset;    // int32_t[reservation_count]: baris reservasi urut per dokter
+    uint64_t doctor_users_offset; // int32_t[doctor_user_count]: index user ber-role dokter
+    uint64_t days_offset;         // RatingDays[days_count]
+    uint64_t index_offset;        // uint32_t[index_capacity]: index user + 1, 0 = kosong
+} SnapshotHeader;
 
-    if (right < heap->size &&
-        compare_reservations(heap->data[right]->res, heap->data[smallest]->res) < 0)
-        smallest = right;
+typedef struct
+{
+    char username[20];
+    char password[20];
+    uint32_t hash; // hash_function(username), key index linear probing
+    int32_t role;
+    int32_t total_rating;
+    int32_t rating_count;
+    int32_t rating_hist[5];
+    int32_t first_reservation; // reservasi user ini: [first, first + count)
+    int32_t reservation_count;
+    int32_t days; // index RatingDays, -1 = tidak ada
+} SnapshotUser;
 
-    if (smallest != idx)
-    {
-        swap_heap_nodes(&heap->data[idx], &heap->data[smallest]);
-        heapify_down(heap, smallest);
-    }
-}
+typedef struct
+{
+    int32_t when;
+    int32_t doctor_id;
+    int32_t patient; // index SnapshotUser
+    char notes[100];
+} SnapshotReservation;
 
-void insert_heap(ReservationHeap *heap, ReservationNode *res)
+typedef struct
 {
-    if (heap->size >= MAX_HEAP)
-        return;
-    HeapNode *node = (HeapNode *)malloc(sizeof(HeapNode));
-    node->res = res;
-    heap->data[heap->size] = node;
-    heapify_up(heap, heap->size);
-    heap->size++;
-}
+    char name[52];   // DoctorSchedule.doctor + padding
+    int32_t first;   // range di by_doctor
+    int32_t count;
+} SnapshotDoctor;
+
+#define SNAPSHOT_USER_MAPPED 0  // hanya ada di file
+#define SNAPSHOT_USER_LIVE 1    // sudah di hash table
+#define SNAPSHOT_USER_DELETED 2 // dihapus setelah startup
+#define SNAPSHOT_ROW_GONE ((ReservationNode *)-1) // reservasi sudah di-free
+
+// clinic.snap yang sedang dipakai. User dibuat (materialize) saat pertama
+// dicari, jadwal dokter saat pertama dibaca; sisanya tetap di file.
+// Ditutup (semua di-materialize lalu unmap) sebelum compaction / server
+typedef struct
+{
+    const SnapshotHeader *header; // NULL = tidak ada snapshot aktif
+    const SnapshotUser *users;
+    const SnapshotReservation *reservations;
+    const SnapshotDoctor *doctors;
+    const int32_t *by_doctor;
+    const int32_t *doctor_users;
+    const RatingDays *days;
+    const uint32_t *index;
+    unsigned char *user_state; // SNAPSHOT_USER_* per user
+    ReservationNode **nodes;   // per baris reservasi: NULL = belum dibuat
+    mutex_t lock;
+} ClinicSnapshot;
+
+// Satu baris request batch: objek JSON datar, semua value disimpan
+// sebagai teks (string sudah di-unescape, angka apa adanya)
+typedef struct
+{
+    char key[24];
+    char value[256];
+} JsonField;
 
-HeapNode *extract_min(ReservationHeap *heap)
+typedef struct
 {
-    if (heap->size == 0)
-        return NULL;
-    HeapNode *min = heap->data[0];
-    heap->data[0] = heap->data[--heap->size];
-    heapify_down(heap, 0);
-    return min;
-}
+    JsonField fields[JSON_MAX_FIELDS];
+    int count;
+} JsonObject;
 
-TrieNode *create_trie_node()
+// State login satu aliran request. Id user disimpan (bukan User *)
+// supaya sesi tetap aman jika user-nya dihapus di tengah batch
+typedef struct
 {
-    TrieNode *node = (TrieNode *)malloc(sizeof(TrieNode));
-    if (node)
-    {
-        node->is_end_of_word = 0;
-        for (int i = 0; i < ALPHABET_SIZE; i++)
-            node->children[i] = NULL;
-        node->username[0] = '\0';
-    }
-    return node;
-}
+    int user_id; // -1 = belum login
+} BatchSession;
 
-void insert_trie(TrieNode *root, const char *username)
+// Balasan satu request, berupa field JSON tanpa kurung kurawal
+typedef struct
 {
-    TrieNode *cur = root;
-    for (int i = 0; username[i]; i++)
-    {
-        char ch = tolower(username[i]);
-        if (ch < 'a' || ch > 'z')
-            continue;
+    char buf[1024];
+    size_t len;
+} BatchReply;
 
-        int idx = ch - 'a';
-        if (!cur->children[idx])
-            cur->children[idx] = create_trie_node();
-        cur = cur->children[idx];
-    }
-    cur->is_end_of_word = 1;
+TrieNode *trie_root = NULL;
+DoctorIndex doctor_index;
+Journal journal;
+ReservationStore reservation_store;
+UserIndex user_index;
+RatingLog rating_log = {"ratings.csv", "rating_totals.csv", 0, 0, 0};
+ReservationArchive archive = {ARCHIVE_DIR, INT_MIN, NULL, 0, 0, NULL, 0, 0};
+ClinicSnapshot snapshot;
 
-    // Store lowercase version to match what's in the hash table
-    strncpy(cur->username, username, sizeof(cur->username));
-    cur->username[sizeof(cur->username) - 1] = '\0';
-}
+// ======================= [PLATFORM] =======================
+// Pembungkus kecil untuk thread, memory-mapped file dan timer
+// supaya kode di bawah tidak perlu #ifdef _WIN32 di mana-mana
 
-// Function untuk insert user ke hash table
-// dengan chaining untuk mengatasi collision
-// Jika username sudah ada, tidak akan ditambahkan
-// dan akan menampilkan pesan error
-void insert_user(hash_table *ht, const char *username, const char *password, int role)
+#ifdef _WIN32
+typedef HANDLE thread_t;
+
+typedef struct
 {
-    int idx = hash_function(username);
-    User *u = (User *)malloc(sizeof(User));
+    void *(*fn)(void *);
+    void *arg;
+} ThreadStart;
 
-    if (!u)
+static DWORD WINAPI thread_trampoline(LPVOID param)
+{
+    ThreadStart start = *(ThreadStart *)param;
+    free(param);
+    start.fn(start.arg);
+    return 0;
+}
+#else
+typedef pthread_t thread_t;
+#endif
+
+int thread_start(thread_t *t, void *(*fn)(void *), void *arg)
+{
+#ifdef _WIN32
+    ThreadStart *start = (ThreadStart *)malloc(sizeof(ThreadStart));
+    if (!start)
+        return 0;
+    start->fn = fn;
+    start->arg = arg;
+    *t = CreateThread(NULL, 0, thread_trampoline, start, 0, NULL);
+    if (!*t)
     {
-        puts("Memory allocation failed");
-        return;
+        free(start);
+        return 0;
     }
-    strncpy(u->username, username, sizeof(u->username) - 1);
-    u->username[sizeof(u->username) - 1] = '\0';
-    strncpy(u->password, password, sizeof(u->password) - 1);
-    u->password[sizeof(u->password) - 1] = '\0';
+    return 1;
+#else
+    return pthread_create(t, NULL, fn, arg) == 0;
+#endif
+}
 
-    u->role = role;
-    u->available = (role == ROLE_DOCTOR) ? 1 : 0;
-    u->reservations_front = NULL;
-    u->reservations_rear = NULL;
-    u->next = ht->table[idx];
+void thread_join(thread_t t)
+{
+#ifdef _WIN32
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+#else
+    pthread_join(t, NULL);
+#endif
+}
 
-    u->total_rating = 0; // Initialize total rating
-    u->rating_count = 0; // Initialize rating count
+int cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+void sleep_ms(int ms)
+{
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    struct timespec ts = {ms / 1000, (ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+#endif
+}
 
-    ht->table[idx] = u;
+// Waktu lokal sekarang (versi thread-safe dari localtime)
+void local_time_now(struct tm *out)
+{
+    time_t t = time(NULL);
+#ifdef _WIN32
+    localtime_s(out, &t);
+#else
+    localtime_r(&t, out);
+#endif
 }
 
-// Function untuk mencari user berdasarkan username
-User *find_user(hash_table *ht, const char *username)
+// Waktu monotonic dalam milidetik, hanya untuk mengukur durasi
+double now_ms(void)
 {
-    int idx = hash_function(username);
-    for (User *cur = ht->table[idx]; cur; cur = cur->next)
-    {
-        if (strcmp(cur->username, username) == 0)
-            return cur;
-    }
-    return NULL;
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / (double)freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+#endif
 }
 
-void save_reservations_to_csv(hash_table *ht, const char *filename)
+// Versi integer nanodetik untuk histogram latency
+int64_t now_ns(void)
 {
-    FILE *file = fopen(filename, "w"); // overwrite
-    if (!file)
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER counter;
+    if (!freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart / freq.QuadPart * 1000000000LL + counter.QuadPart % freq.QuadPart * 1000000000LL / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+typedef struct
+{
+    const char *data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+} MappedFile;
+
+// Memetakan seluruh file read-only ke memori
+// Return 0 jika file tidak ada; file kosong berhasil dengan size 0
+int map_file(const char *path, MappedFile *m)
+{
+    m->data = NULL;
+    m->size = 0;
+#ifdef _WIN32
+    m->mapping = NULL;
+    m->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                          FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (m->file == INVALID_HANDLE_VALUE)
+        return 0;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m->file, &size))
     {
-        puts("Failed to open file to save reservations.");
-        return;
+        CloseHandle(m->file);
+        return 0;
     }
+    m->size = (size_t)size.QuadPart;
+    if (m->size == 0)
+        return 1;
+
+    m->mapping = CreateFileMappingA(m->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m->mapping)
+        m->data = (const char *)MapViewOfFile(m->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m->data)
+    {
+        if (m->mapping)
+            CloseHandle(m->mapping);
+        CloseHandle(m->file);
+        return 0;
+    }
+    return 1;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return 0;
 
-    fprintf(file, "username,date,time,doctor,notes\n"); // CSV header
-
-    for (int i = 0; i < TABLE_SIZE; i++)
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return 0;
+    }
+    m->size = (size_t)st.st_size;
+    if (m->size > 0)
     {
-        User *u = ht->table[i];
-        while (u)
+        void *data = mmap(NULL, m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED)
         {
-            ReservationNode *res = u->reservations_front;
-            while (res)
-            {
-                fprintf(file, "%s,%s,%s,%s,%s\n",
-                        u->username,
-                        res->date,
-                        res->time,
-                        res->doctor,
-                        res->notes);
-                res = res->next;
-            }
-            u = u->next;
+            close(fd);
+            return 0;
         }
+        madvise(data, m->size, MADV_SEQUENTIAL);
+        m->data = (const char *)data;
     }
+    close(fd);
+    return 1;
+#endif
+}
 
-    fclose(file);
-    puts("Reservations saved to file successfully.");
+void unmap_file(MappedFile *m)
+{
+#ifdef _WIN32
+    if (m->data)
+        UnmapViewOfFile(m->data);
+    if (m->mapping)
+        CloseHandle(m->mapping);
+    if (m->file != INVALID_HANDLE_VALUE)
+        CloseHandle(m->file);
+#else
+    if (m->data)
+        munmap((void *)m->data, m->size);
+#endif
+    m->data = NULL;
+    m->size = 0;
 }
 
-void load_reservations_from_csv(hash_table *ht, const char *filename)
+// Ukuran & waktu modifikasi file, size -1 jika tidak ada
+FileStamp file_stamp(const char *path)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
+    FileStamp stamp = {-1, 0};
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA info;
+    if (GetFileAttributesExA(path, GetFileExInfoStandard, &info))
     {
-        puts("No existing reservation data found.");
-        return;
+        stamp.size = (int64_t)info.nFileSizeHigh << 32 | info.nFileSizeLow;
+        ULARGE_INTEGER t;
+        t.LowPart = info.ftLastWriteTime.dwLowDateTime;
+        t.HighPart = info.ftLastWriteTime.dwHighDateTime;
+        stamp.mtime = (int64_t)(t.QuadPart / 10000000ULL);
     }
-
-    char line[300];
-    fgets(line, sizeof(line), file); // skip header
-
-    while (fgets(line, sizeof(line), file))
+#else
+    struct stat st;
+    if (stat(path, &st) == 0)
     {
-        char username[20], date[20], time[10], doctor[50], notes[100];
-        if (sscanf(line, "%19[^,],%19[^,],%9[^,],%49[^,],%99[^\n]",
-                   username, date, time, doctor, notes) == 5)
-        {
-
-            User *u = find_user(ht, username);
-            if (!u)
-                continue; // skip if user not found
-
-            ReservationNode *res = (ReservationNode *)malloc(sizeof(ReservationNode));
-            if (!res)
-                continue;
+        stamp.size = (int64_t)st.st_size;
+        stamp.mtime = (int64_t)st.st_mtime;
+    }
+#endif
+    return stamp;
+}
 
-            strcpy(res->patient_username, username);
-            strcpy(res->date, date);
-            strcpy(res->time, time);
-            strcpy(res->doctor, doctor);
-            strcpy(res->notes, notes);
-            res->next = NULL;
+// Flush buffer stdio lalu paksa data sampai ke disk
+int sync_file(FILE *file)
+{
+    if (fflush(file) != 0)
+        return 0;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
 
-            if (u->reservations_rear == NULL)
-            {
-                u->reservations_front = u->reservations_rear = res;
-            }
-            else
-            {
-                u->reservations_rear->next = res;
-                u->reservations_rear = res;
-            }
-        }
-    }
+// Mengganti file lama dengan file tmp yang sudah lengkap ditulis
+int replace_file(const char *tmp_path, const char *path)
+{
+#ifdef _WIN32
+    remove(path); // rename di Windows gagal jika tujuan sudah ada
+#endif
+    return rename(tmp_path, path) == 0;
+}
 
-    fclose(file);
-    puts("Reservations loaded from file.");
+// Membuat direktori; sukses juga jika direktori sudah ada
+int make_dir(const char *path)
+{
+#ifdef _WIN32
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
 }
 
-// Fungsi untuk AVL
+int change_dir(const char *path)
+{
+#ifdef _WIN32
+    return SetCurrentDirectoryA(path) != 0;
+#else
+    return chdir(path) == 0;
+#endif
+}
 
-int height(AVLNode *node)
+void mutex_init(mutex_t *m)
 {
-    return node ? node->height : 0;
+#ifdef _WIN32
+    InitializeSRWLock(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
 }
 
-int max(int a, int b)
+void mutex_lock(mutex_t *m)
 {
-    return (a > b) ? a : b;
+#ifdef _WIN32
+    AcquireSRWLockExclusive(m);
+#else
+    pthread_mutex_lock(m);
+#endif
 }
 
-int get_balance(AVLNode *node)
+void mutex_unlock(mutex_t *m)
 {
-    if (!node)
-        return 0;
-    return height(node->left) - height(node->right);
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
 }
 
-// Rotation
-AVLNode *right_rotate(AVLNode *y)
+void rwlock_init(rwlock_t *l)
 {
-    AVLNode *x = y->left;
-    AVLNode *T2 = x->right;
+#ifdef _WIN32
+    InitializeSRWLock(l);
+#else
+    pthread_rwlock_init(l, NULL);
+#endif
+}
 
-    x->right = y;
-    y->left = T2;
+void rwlock_read_lock(rwlock_t *l)
+{
+#ifdef _WIN32
+    AcquireSRWLockShared(l);
+#else
+    pthread_rwlock_rdlock(l);
+#endif
+}
 
-    y->height = max(height(y->left), height(y->right)) + 1;
-    x->height = max(height(x->left), height(x->right)) + 1;
+void rwlock_read_unlock(rwlock_t *l)
+{
+#ifdef _WIN32
+    ReleaseSRWLockShared(l);
+#else
+    pthread_rwlock_unlock(l);
+#endif
+}
 
-    return x;
+void rwlock_write_lock(rwlock_t *l)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(l);
+#else
+    pthread_rwlock_wrlock(l);
+#endif
 }
 
-AVLNode *left_rotate(AVLNode *x)
+// Return 1 jika lock didapat tanpa menunggu
+int rwlock_try_write_lock(rwlock_t *l)
 {
-    AVLNode *y = x->right;
-    AVLNode *T2 = y->left;
+#ifdef _WIN32
+    return TryAcquireSRWLockExclusive(l) != 0;
+#else
+    return pthread_rwlock_trywrlock(l) == 0;
+#endif
+}
 
-    y->left = x;
-    x->right = T2;
+void rwlock_write_unlock(rwlock_t *l)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(l);
+#else
+    pthread_rwlock_unlock(l);
+#endif
+}
 
-    x->height = max(height(x->left), height(x->right)) + 1;
-    y->height = max(height(y->left), height(y->right)) + 1;
+void cond_init(cond_t *c)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(c);
+#else
+    pthread_cond_init(c, NULL);
+#endif
+}
 
-    return y;
+void cond_wait(cond_t *c, mutex_t *m)
+{
+#ifdef _WIN32
+    SleepConditionVariableSRW(c, m, INFINITE, 0);
+#else
+    pthread_cond_wait(c, m);
+#endif
 }
 
-int compare_date(const char *d1, const char *d2)
+void cond_signal(cond_t *c)
 {
-    return strcmp(d1, d2); // since format is YYYY-MM-DD, lexicographic comparison works!
+#ifdef _WIN32
+    WakeConditionVariable(c);
+#else
+    pthread_cond_signal(c);
+#endif
 }
 
-AVLNode *insert_avl(AVLNode *node, ReservationNode *res)
+// Socket TCP yang hanya menerima koneksi lokal (127.0.0.1)
+socket_t net_listen(int port)
 {
-    if (!node)
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+        return NET_INVALID;
+#endif
+    socket_t s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s == NET_INVALID)
+        return NET_INVALID;
+
+    int yes = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (const char *)&yes, sizeof(yes));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(s, SERVER_QUEUE_SIZE) != 0)
     {
-        AVLNode *new_node = (AVLNode *)malloc(sizeof(AVLNode));
-        new_node->res = res;
-        new_node->left = new_node->right = NULL;
-        new_node->height = 1;
-        return new_node;
+#ifdef _WIN32
+        closesocket(s);
+#else
+        close(s);
+#endif
+        return NET_INVALID;
     }
+    return s;
+}
 
-    int cmp = compare_date(res->date, node->res->date);
-
-    if (cmp == 0)
-        cmp = strcmp(res->time, node->res->time);
-    if (cmp == 0)
-        cmp = strcmp(res->doctor, node->res->doctor);
-    if (cmp < 0)
-        node->left = insert_avl(node->left, res);
-    else if (cmp > 0)
-        node->right = insert_avl(node->right, res);
-    else
-        return node; // duplicate date (optional)
+socket_t net_accept(socket_t s)
+{
+    return accept(s, NULL, NULL);
+}
 
-    node->height = 1 + max(height(node->left), height(node->right));
-    int balance = get_balance(node);
+// Return jumlah byte, 0 jika koneksi ditutup, < 0 jika error
+int net_recv(socket_t s, char *buf, int cap)
+{
+    return (int)recv(s, buf, cap, 0);
+}
 
-    if (balance > 1 && compare_date(res->date, node->left->res->date) < 0)
-        return right_rotate(node);
-    if (balance < -1 && compare_date(res->date, node->right->res->date) > 0)
-        return left_rotate(node);
-    if (balance > 1 && compare_date(res->date, node->left->res->date) > 0)
-    {
-        node->left = left_rotate(node->left);
-        return right_rotate(node);
-    }
-    if (balance < -1 && compare_date(res->date, node->right->res->date) < 0)
+int net_send_all(socket_t s, const char *buf, int len)
+{
+#ifdef MSG_NOSIGNAL
+    int flags = MSG_NOSIGNAL; // klien yang sudah tutup tidak boleh mematikan server
+#else
+    int flags = 0;
+#endif
+    while (len > 0)
     {
-        node->right = right_rotate(node->right);
-        return left_rotate(node);
+        int n = (int)send(s, buf, len, flags);
+        if (n <= 0)
+            return 0;
+        buf += n;
+        len -= n;
     }
+    return 1;
+}
 
-    return node;
+void net_close(socket_t s)
+{
+#ifdef _WIN32
+    closesocket(s);
+#else
+    close(s);
+#endif
 }
 
-void inorder_traversal_avl(AVLNode *node, int is_doctor_view)
+// ======================= [TERMINAL] =======================
+// Layar & keyboard untuk menu interaktif tanpa menjalankan proses lain
+// (dulu system("cls") memanggil shell setiap menu digambar ulang).
+// Jika stdin/stdout bukan terminal (input dari pipe, output ke file),
+// layar tidak dibersihkan dan input dibaca per baris seperti biasa
+
+// Membersihkan layar dan memindahkan kursor ke kiri atas
+void term_clear(void)
 {
-    if (!node)
+#ifdef _WIN32
+    HANDLE out = GetStdHandle(STD_OUTPUT_HANDLE);
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    fflush(stdout);
+    if (!GetConsoleScreenBufferInfo(out, &info))
         return;
+    DWORD cells = (DWORD)info.dwSize.X * info.dwSize.Y, written;
+    COORD home = {0, 0};
+    FillConsoleOutputCharacterA(out, ' ', cells, home, &written);
+    FillConsoleOutputAttribute(out, info.wAttributes, cells, home, &written);
+    SetConsoleCursorPosition(out, home);
+#else
+    // Masuk buffer stdout bersama baris menu pertama, bukan write sendiri
+    if (isatty(STDOUT_FILENO))
+        fputs("\033[H\033[2J\033[3J", stdout);
+#endif
+}
 
-    inorder_traversal_avl(node->left, is_doctor_view);
+// Membaca satu tombol tanpa menunggu Enter dan tanpa echo
+int term_getch(void)
+{
+    fflush(stdout);
+#ifdef _WIN32
+    return _getch();
+#else
+    struct termios saved, raw;
+    if (!isatty(STDIN_FILENO) || tcgetattr(STDIN_FILENO, &saved) != 0)
+        return getchar();
+    raw = saved;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    int c = getchar(); // sisa input di buffer stdio dipakai lebih dulu
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+    return c;
+#endif
+}
 
-    ReservationNode *res = node->res;
-    if (is_doctor_view)
-    {
-        printf("Patient: %s\n", res->patient_username);
-    }
+// ======================= [METRICS] =======================
+// Jumlah panggilan dan histogram latency per operasi inti. Setiap thread
+// menulis ke bloknya sendiri tanpa lock; pembaca (menu Admin, file
+// metrics.csv) menjumlahkan blok semua thread. Histogram bergaya HDR:
+// 16 sub-bucket per pangkat dua nanodetik, jadi error relatif <= 6%.
+// Operasi yang jauh lebih cepat dari pembacaan jam (find_user,
+// insert_avl) selalu dihitung tapi latency-nya di-sample.
+// Build dengan -DCLINIC_NO_METRICS menghapus semua pengukuran
+
+static const char *const metric_names[METRIC_COUNT] = {
+    "find_user", "insert_avl", "save_users_to_csv", "save_reservations", "save_snapshot",
+    "compact_journal", "compact_ratings", "load_users", "load_reservations", "load_ratings",
+    "report", "booking_analytics", "load_archive", "range_query",
+    // urutan sama dengan batch_ops (lihat [BATCH MODE])
+    "request register", "request login", "request logout", "request create", "request cancel",
+    "request view", "request rate", "request report", "request delete"};
+
+#ifndef CLINIC_NO_METRICS
+typedef struct MetricBlock
+{
+    struct MetricBlock *next;
+    uint64_t count[METRIC_COUNT];
+    uint64_t total_ns[METRIC_COUNT];
+    uint64_t max_ns[METRIC_COUNT];
+    uint64_t hist[METRIC_COUNT][METRIC_BUCKETS];
+} MetricBlock;
+
+static MetricBlock *metric_blocks;         // semua blok, hanya bertambah (atomik)
+static __thread MetricBlock *metric_block; // blok milik thread ini
+static __thread unsigned int metric_tick;  // penghitung sampling thread ini
+
+static MetricBlock *metric_block_create(void)
+{
+    MetricBlock *b = (MetricBlock *)calloc(1, sizeof(MetricBlock));
+    if (!b)
+        return NULL;
+    b->next = __atomic_load_n(&metric_blocks, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&metric_blocks, &b->next, b, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+        ;
+    return metric_block = b;
+}
 
-    printf("Date: %s\nTime: %s\nDoctor: %s\nNotes: %s\n\n",
-           res->date, res->time, res->doctor, res->notes);
+// Nilai < 16 ns punya bucket sendiri, selebihnya 16 sub-bucket per pangkat dua
+static int metric_bucket(uint64_t ns)
+{
+    if (ns < 16)
+        return (int)ns;
+    int e = 63 - __builtin_clzll(ns);
+    int bucket = (e - 3) * 16 + (int)(ns >> (e - 4) & 15);
+    return bucket < METRIC_BUCKETS ? bucket : METRIC_BUCKETS - 1;
+}
 
-    inorder_traversal_avl(node->right, is_doctor_view);
+// Nilai tengah bucket, dipakai sebagai hasil percentile
+static uint64_t metric_bucket_value(int bucket)
+{
+    if (bucket < 16)
+        return (uint64_t)bucket;
+    int e = bucket / 16 + 3;
+    uint64_t low = (uint64_t)(16 + bucket % 16) << (e - 4);
+    return low + ((1ULL << (e - 4)) >> 1);
 }
 
-// Pause console untuk menunggu input dari user
-void pause_console(void)
+// Hanya pemilik blok yang menulis: load biasa lalu store atomik sudah
+// cukup supaya pembaca tidak melihat nilai setengah jadi
+static inline void metric_add(uint64_t *counter, uint64_t v)
 {
-    printf("Press any key to continue...");
-    _getch();
-    printf("\n");
+    __atomic_store_n(counter, *counter + v, __ATOMIC_RELAXED);
 }
 
-// ======================= [ADMIN FUNCTIONS] =======================
+// ns < 0 = panggilan yang tidak di-sample, hanya dihitung
+void metric_record(int id, int64_t ns)
+{
+    MetricBlock *b = metric_block ? metric_block : metric_block_create();
+    if (!b)
+        return;
+    metric_add(&b->count[id], 1);
+    if (ns < 0)
+        return;
+    uint64_t v = (uint64_t)ns;
+    metric_add(&b->total_ns[id], v);
+    metric_add(&b->hist[id][metric_bucket(v)], 1);
+    if (v > b->max_ns[id])
+        __atomic_store_n(&b->max_ns[id], v, __ATOMIC_RELAXED);
+}
 
-// Fungsi untuk menampilkan semua user
-// yang ada di hash table
-void view_all_users(hash_table *ht)
+static inline int64_t metric_start(void)
 {
-    puts("=== List of Users ===");
-    for (int i = 0; i < TABLE_SIZE; i++)
-    {
-        User *cur = ht->table[i];
-        while (cur)
-        {
-            const char *role_str = (cur->role == ROLE_ADMIN) ? "Admin" : (cur->role == ROLE_DOCTOR) ? "Doctor"
-                                                                                                    : "Client";
-            printf("Username: %s | Role: %s\n", cur->username, role_str);
-            cur = cur->next;
-        }
-    }
+    return now_ns();
 }
 
-// Fungsi untuk menghapus user berdasarkan username
-// Jika user ditemukan, akan menghapus user dan semua reservasi yang dimilikinya
-// Jika tidak ditemukan, akan menampilkan pesan error
-void delete_user(hash_table *ht, const char *username)
+// Untuk operasi pendek: -1 (tidak diukur) kecuali 1 dari 64 panggilan
+static inline int64_t metric_start_sampled(void)
+{
+    return ++metric_tick & METRIC_SAMPLE_MASK ? -1 : now_ns();
+}
+
+static inline void metric_stop(int id, int64_t started)
 {
-    int idx = hash_function(username);
-    User *cur = ht->table[idx];
-    User *prev = NULL;
+    metric_record(id, started < 0 ? -1 : now_ns() - started);
+}
 
-    while (cur)
+typedef struct
+{
+    uint64_t count;   // semua panggilan
+    uint64_t samples; // panggilan yang latency-nya diukur
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t p50, p90, p99, p999;
+} MetricSummary;
+
+// Menjumlahkan blok semua thread untuk satu operasi
+static void metric_summarize(int id, MetricSummary *s)
+{
+    uint64_t hist[METRIC_BUCKETS] = {0};
+    memset(s, 0, sizeof(*s));
+    for (MetricBlock *b = __atomic_load_n(&metric_blocks, __ATOMIC_ACQUIRE); b; b = b->next)
     {
-        if (strcmp(cur->username, username) == 0)
+        for (int i = 0; i < METRIC_BUCKETS; i++)
         {
-            if (prev == NULL)
-            {
-                ht->table[idx] = cur->next;
-            }
-            else
-            {
-                prev->next = cur->next;
-            }
-            // Free all reservations
-            ReservationNode *res = cur->reservations_front;
-            while (res)
-            {
-                ReservationNode *next = res->next;
-                free(res);
-                res = next;
-            }
-            free(cur);
-            printf("User '%s' has been deleted.\n", username);
-            return;
+            uint64_t n = __atomic_load_n(&b->hist[id][i], __ATOMIC_RELAXED);
+            hist[i] += n;
+            s->samples += n;
         }
-        prev = cur;
-        cur = cur->next;
+        s->count += __atomic_load_n(&b->count[id], __ATOMIC_RELAXED);
+        s->total_ns += __atomic_load_n(&b->total_ns[id], __ATOMIC_RELAXED);
+        uint64_t max_ns = __atomic_load_n(&b->max_ns[id], __ATOMIC_RELAXED);
+        if (max_ns > s->max_ns)
+            s->max_ns = max_ns;
     }
-    printf("User '%s' not found.\n", username);
+
+    const int permille[4] = {500, 900, 990, 999};
+    uint64_t *out[4] = {&s->p50, &s->p90, &s->p99, &s->p999};
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < METRIC_BUCKETS && next < 4; i++)
+    {
+        seen += hist[i];
+        while (next < 4 && hist[i] && seen * 1000 >= s->samples * permille[next])
+            *out[next++] = metric_bucket_value(i);
+    }
+    for (int i = 0; i < 4; i++) // tengah bucket terakhir bisa melewati max
+        *out[i] = *out[i] < s->max_ns ? *out[i] : s->max_ns;
 }
 
-void generate_report_with_heap(hash_table *ht)
+// Durasi dengan satuan yang pas: "85 ns", "12.3 us", "4.56 ms", "1.23 s"
+static const char *format_ns(uint64_t ns, char *buf, size_t cap)
 {
-    ReservationHeap heap;
-    heap.size = 0;
+    if (ns < 1000)
+        snprintf(buf, cap, "%llu ns", (unsigned long long)ns);
+    else if (ns < 1000000)
+        snprintf(buf, cap, "%.1f us", ns / 1e3);
+    else if (ns < 1000000000)
+        snprintf(buf, cap, "%.2f ms", ns / 1e6);
+    else
+        snprintf(buf, cap, "%.2f s", ns / 1e9);
+    return buf;
+}
 
-    // Collect all reservations
-    for (int i = 0; i < TABLE_SIZE; i++)
+// Tabel count, mean, p50/p90/p99/p99.9 dan max untuk operasi yang pernah jalan
+void print_metrics(FILE *out)
+{
+    fprintf(out, "%-20s %10s %10s %10s %10s %10s %10s %10s\n", "operation", "count", "mean", "p50", "p90", "p99",
+            "p99.9", "max");
+    for (int id = 0; id < METRIC_COUNT; id++)
     {
-        User *u = ht->table[i];
-        while (u)
-        {
-            ReservationNode *res = u->reservations_front;
-            while (res)
-            {
-                insert_heap(&heap, res);
-                res = res->next;
-            }
-            u = u->next;
-        }
+        MetricSummary s;
+        metric_summarize(id, &s);
+        if (!s.samples)
+            continue;
+        char mean[16], p50[16], p90[16], p99[16], p999[16], max_ns[16];
+        fprintf(out, "%-20s %10llu %10s %10s %10s %10s %10s %10s\n", metric_names[id], (unsigned long long)s.count,
+                format_ns(s.total_ns / s.samples, mean, sizeof(mean)), format_ns(s.p50, p50, sizeof(p50)),
+                format_ns(s.p90, p90, sizeof(p90)), format_ns(s.p99, p99, sizeof(p99)),
+                format_ns(s.p999, p999, sizeof(p999)), format_ns(s.max_ns, max_ns, sizeof(max_ns)));
     }
+}
 
-    if (heap.size == 0)
+// Menambahkan snapshot kumulatif semua operasi ke path (satu baris per
+// operasi, waktu dalam mikrodetik). Dilewati jika tidak ada panggilan
+// baru sejak penulisan sebelumnya
+void write_metrics_file(const char *path)
+{
+    static uint64_t last_total;
+    MetricSummary s[METRIC_COUNT];
+    uint64_t total = 0;
+    for (int id = 0; id < METRIC_COUNT; id++)
     {
-        puts("No reservations to report.");
-        return;
+        metric_summarize(id, &s[id]);
+        total += s[id].count;
     }
+    if (total == last_total)
+        return;
 
-    puts("=== Upcoming Appointments Report ===");
-    while (heap.size > 0)
+    FILE *file = fopen(path, "a");
+    if (!file)
+        return;
+    if (ftell(file) == 0)
+        fprintf(file, "timestamp,operation,count,mean_us,p50_us,p90_us,p99_us,p999_us,max_us\n");
+    long long now = (long long)time(NULL);
+    for (int id = 0; id < METRIC_COUNT; id++)
     {
-        HeapNode *node = extract_min(&heap);
-        printf("Date: %s | Time: %s | Doctor: %s | Patient: %s | Notes: %s\n",
-               node->res->date,
-               node->res->time,
-               node->res->doctor,
-               node->res->patient_username,
-               node->res->notes);
-        free(node);
+        if (s[id].samples)
+            fprintf(file, "%lld,%s,%llu,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n", now, metric_names[id],
+                    (unsigned long long)s[id].count, s[id].total_ns / 1e3 / s[id].samples, s[id].p50 / 1e3,
+                    s[id].p90 / 1e3, s[id].p99 / 1e3, s[id].p999 / 1e3, s[id].max_ns / 1e3);
     }
+    fclose(file);
+    last_total = total;
+}
+#else
+static inline int64_t metric_start(void)
+{
+    return 0;
 }
 
-void to_lowercase(char *str)
+static inline int64_t metric_start_sampled(void)
 {
-    for (int i = 0; str[i]; i++)
+    return 0;
+}
+
+static inline void metric_stop(int id, int64_t started)
+{
+    (void)id;
+    (void)started;
+}
+
+void print_metrics(FILE *out)
+{
+    fprintf(out, "Metrics disabled (built with -DCLINIC_NO_METRICS).\n");
+}
+
+void write_metrics_file(const char *path)
+{
+    (void)path;
+}
+#endif
+
+// ======================= [MEMORY POOLS] =======================
+// Pool untuk record berukuran tetap. Memori diambil per slab
+// (POOL_SLAB_BYTES), slot yang di-free masuk free list dan dipakai ulang.
+// Pool global dikunci lewat lock (diisi init_locks) karena dipakai
+// worker server; pool lokal loader per chunk (lock NULL) tidak dikunci
+// dan digabung dengan pool_absorb.
+
+typedef struct pool_slab
+{
+    struct pool_slab *next;
+    size_t bytes;
+} PoolSlab;
+
+typedef struct
+{
+    const char *name;
+    size_t item_size;
+    void *free_list;
+    PoolSlab *slabs;
+    char *cursor; // sisa slot yang belum pernah dipakai di slab terakhir
+    char *limit;
+    long long allocs;
+    long long frees;
+    long long live;
+    int slab_count;
+    mutex_t *lock; // NULL = hanya dipakai satu thread
+} Pool;
+
+#define POOL_ALIGN 16
+#define POOL_HEADER_SIZE ((sizeof(PoolSlab) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+// Arena untuk struktur sementara (AVL tampilan, heap laporan).
+// Alokasi hanya menggeser pointer; arena_reset mengembalikan semuanya
+// dalam O(1) dan block yang sudah ada dipakai ulang
+typedef struct arena_block
+{
+    struct arena_block *next;
+    size_t size;
+} ArenaBlock;
+
+typedef struct
+{
+    const char *name;
+    ArenaBlock *first;
+    ArenaBlock *current;
+    size_t used; // offset di block current
+    size_t bytes_in_use;
+    size_t peak_bytes;
+    long long allocs;
+    long long resets;
+    int block_count;
+} Arena;
+
+#define ARENA_HEADER_SIZE ((sizeof(ArenaBlock) + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1))
+
+#define POOL_INIT(type) {#type, sizeof(type), NULL, NULL, NULL, NULL, 0, 0, 0, 0, NULL}
+
+Pool user_pool = POOL_INIT(User);
+Pool reservation_pool = POOL_INIT(ReservationNode);
+Pool avl_pool = POOL_INIT(AVLNode);
+Pool trie_pool = POOL_INIT(TrieNode);
+Pool rating_days_pool = POOL_INIT(RatingDays);
+Arena scratch_arena = {"Scratch", NULL, NULL, 0, 0, 0, 0, 0, 0};
+
+// Lock untuk akses paralel dari worker server. Urutan pengambilan:
+// table_lock -> snapshot.lock -> satu user lock -> report_lock -> lock
+// jadwal dokter (urut id) -> lock pool. Penulisan file lewat ring
+// persistence (lock-free)
+rwlock_t table_lock; // struktur hash table: exclusive untuk register/hapus user/compaction
+mutex_t user_locks[USER_LOCK_STRIPES]; // AVL reservasi & rating milik user
+mutex_t report_lock;                   // scratch_arena
+rwlock_t trie_lock;                    // radix tree dokter & cache rating-nya
+static mutex_t pool_locks[5];
+
+void init_locks(void)
+{
+    rwlock_init(&table_lock);
+    for (int i = 0; i < USER_LOCK_STRIPES; i++)
+        mutex_init(&user_locks[i]);
+    mutex_init(&report_lock);
+    rwlock_init(&trie_lock);
+    mutex_init(&reservation_store.lock);
+    mutex_init(&snapshot.lock);
+
+    Pool *pools[] = {&user_pool, &reservation_pool, &avl_pool, &trie_pool, &rating_days_pool};
+    for (int i = 0; i < 5; i++)
     {
-        str[i] = tolower(str[i]);
+        mutex_init(&pool_locks[i]);
+        pools[i]->lock = &pool_locks[i];
     }
 }
 
-void print_rating_trie(TrieNode *node, hash_table *ht)
+static size_t pool_item_size(const Pool *pool)
 {
-    if (!node)
-        return;
+    size_t size = pool->item_size < sizeof(void *) ? sizeof(void *) : pool->item_size;
+    return (size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+}
 
-    if (node->is_end_of_word)
+static void *pool_alloc_unlocked(Pool *pool)
+{
+    void *item;
+    if (pool->free_list)
     {
-        char lowered[20];
-        strncpy(lowered, node->username, sizeof(lowered));
-        lowered[sizeof(lowered) - 1] = '\0';
-        to_lowercase(lowered);
-
-        User *u = find_user(ht, node->username);
-        if (u && u->role == ROLE_DOCTOR)
-        {
-            if (u->rating_count > 0)
-            {
-                float avg = (float)u->total_rating / u->rating_count;
-                printf("- %s - Avg Rating: %.2f (%d ratings)\n", u->username, avg, u->rating_count);
-            }
-            else
-            {
-                printf("- %s - No ratings yet\n", u->username);
-            }
-        }
-        else
-        {
-            printf("- %s - (Doctor not found in system)\n", node->username);
-        }
+        item = pool->free_list;
+        pool->free_list = *(void **)item;
     }
-
-    for (int i = 0; i < ALPHABET_SIZE; i++)
+    else
     {
-        if (node->children[i])
+        size_t size = pool_item_size(pool);
+        if (pool->cursor + size > pool->limit || !pool->cursor)
         {
-            print_rating_trie(node->children[i], ht);
+            size_t per_slab = POOL_SLAB_BYTES / size;
+            if (per_slab < 8)
+                per_slab = 8;
+
+            size_t bytes = POOL_HEADER_SIZE + per_slab * size;
+            PoolSlab *slab = (PoolSlab *)malloc(bytes);
+            if (!slab)
+                return NULL;
+            slab->next = pool->slabs;
+            slab->bytes = bytes;
+            pool->slabs = slab;
+            pool->slab_count++;
+            pool->cursor = (char *)slab + POOL_HEADER_SIZE;
+            pool->limit = (char *)slab + bytes;
         }
+        item = pool->cursor;
+        pool->cursor += size;
     }
+
+    pool->allocs++;
+    pool->live++;
+    return item;
 }
 
-void insert_user_and_trie(hash_table *ht, TrieNode *trie, const char *username, const char *password, int role)
+void *pool_alloc(Pool *pool)
 {
-    char lowered[20];
-    strncpy(lowered, username, sizeof(lowered));
-    lowered[sizeof(lowered) - 1] = '\0';
-    to_lowercase(lowered);
+    if (!pool->lock)
+        return pool_alloc_unlocked(pool);
+    mutex_lock(pool->lock);
+    void *item = pool_alloc_unlocked(pool);
+    mutex_unlock(pool->lock);
+    return item;
+}
 
-    insert_user(ht, lowered, password, role); // lowercase stored in hash table
-    insert_trie(trie, lowered);               // and in Trie
+void pool_free(Pool *pool, void *item)
+{
+    if (!item)
+        return;
+    if (pool->lock)
+        mutex_lock(pool->lock);
+    *(void **)item = pool->free_list;
+    pool->free_list = item;
+    pool->frees++;
+    pool->live--;
+    if (pool->lock)
+        mutex_unlock(pool->lock);
 }
 
-void search_rating_by_prefix(TrieNode *root, hash_table *ht, const char *prefix)
+// Memindahkan semua slab, free list dan counter dari src ke dst.
+// Sisa slot di slab terakhir src yang belum terpakai ikut dibuang ke free list
+void pool_absorb(Pool *dst, Pool *src)
 {
-    TrieNode *cur = root;
-    for (int i = 0; prefix[i]; i++)
+    size_t size = pool_item_size(src);
+    while (src->cursor && src->cursor + size <= src->limit)
     {
-        char ch = tolower(prefix[i]);
-        if (ch < 'a' || ch > 'z')
-            continue;
-        int idx = ch - 'a';
+        *(void **)src->cursor = src->free_list;
+        src->free_list = src->cursor;
+        src->cursor += size;
+    }
 
-        if (!cur->children[idx])
-        {
-            printf("No doctor found with prefix '%s'.\n", prefix);
-            return;
-        }
-        cur = cur->children[idx];
+    while (src->free_list)
+    {
+        void *item = src->free_list;
+        src->free_list = *(void **)item;
+        *(void **)item = dst->free_list;
+        dst->free_list = item;
+    }
+
+    while (src->slabs)
+    {
+        PoolSlab *slab = src->slabs;
+        src->slabs = slab->next;
+        slab->next = dst->slabs;
+        dst->slabs = slab;
     }
 
-    char buffer[50];
-    strcpy(buffer, prefix);
-    print_rating_trie(cur, ht);
+    dst->allocs += src->allocs;
+    dst->frees += src->frees;
+    dst->live += src->live;
+    dst->slab_count += src->slab_count;
+    src->cursor = src->limit = NULL;
+    src->allocs = src->frees = src->live = 0;
+    src->slab_count = 0;
 }
 
-// Fungsi untuk menampilkan menu admin
-void admin_menu(hash_table *ht)
+void *arena_alloc(Arena *arena, size_t size)
 {
-    int choice;
-    do
+    size = (size + POOL_ALIGN - 1) & ~(size_t)(POOL_ALIGN - 1);
+
+    while (!arena->current || arena->used + size > arena->current->size)
     {
-        system("cls");
-        puts("=== ADMIN MENU ===");
-        puts("1. View Users");
-        puts("2. Delete User");
-        puts("3. Generate Report");
-        puts("4. Rating Summary");
-        puts("0. Logout");
-        printf("Choice: ");
-        if (scanf("%d", &choice) != 1)
+        // Pakai block berikutnya yang tersisa dari sebelum reset
+        if (arena->current && arena->current->next)
         {
-            while (getchar() != '\n')
-                ;
-            choice = -1;
+            arena->current = arena->current->next;
+            arena->used = ARENA_HEADER_SIZE;
+            continue;
         }
-        getchar();
 
-        switch (choice)
-        {
-        case 1:
-            view_all_users(ht);
-            pause_console();
-            break;
-        case 2:
-        {
-            char uname[20];
-            printf("Enter username to delete: ");
-            scanf("%19s", uname);
-            getchar();
-            delete_user(ht, uname);
-            pause_console();
-            break;
-        }
-        case 3:
-            generate_report_with_heap(ht);
-            pause_console();
-            break;
-        case 4:
-            char prefix[20];
-            printf("Enter doctor name prefix: ");
-            scanf("%19s", prefix);
-            search_rating_by_prefix(trie_root, ht, prefix);
-            pause_console();
-            break;
-        }
-    } while (choice != 0);
+        size_t bytes = ARENA_HEADER_SIZE + size > ARENA_BLOCK_BYTES ? ARENA_HEADER_SIZE + size : ARENA_BLOCK_BYTES;
+        ArenaBlock *block = (ArenaBlock *)malloc(bytes);
+        if (!block)
+            return NULL;
+        block->next = NULL;
+        block->size = bytes;
+        if (arena->current)
+            arena->current->next = block;
+        else
+            arena->first = block;
+        arena->current = block;
+        arena->used = ARENA_HEADER_SIZE;
+        arena->block_count++;
+    }
+
+    void *p = (char *)arena->current + arena->used;
+    arena->used += size;
+    arena->bytes_in_use += size;
+    if (arena->bytes_in_use > arena->peak_bytes)
+        arena->peak_bytes = arena->bytes_in_use;
+    arena->allocs++;
+    return p;
 }
 
-// ======================= [CLIENT FUNCTIONS] =======================
+// Membebaskan semua alokasi arena sekaligus; block tetap disimpan
+void arena_reset(Arena *arena)
+{
+    arena->current = arena->first;
+    arena->used = ARENA_HEADER_SIZE;
+    arena->bytes_in_use = 0;
+    arena->resets++;
+}
 
-// Fungsi untuk membuat reservasi
-// User akan memasukkan nama dokter, tanggal, waktu, dan catatan
-// Jika dokter tidak ditemukan atau tidak tersedia, akan menampilkan pesan error
+// ======================= [UTILITY FUNCTIONS] =======================
+// Finalizer murmur3: mengaduk bit supaya bit bawah
+// (yang dipakai sebagai index slot) tersebar merata
+unsigned int hash_int(unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
 
-void view_doctors_list(hash_table *ht)
+// Fungsi untuk membuat hash dari username
+// FNV-1a lalu diaduk dengan hash_int
+unsigned int hash_function(const char *username)
 {
-    puts("=== List of Doctors ===");
-    for (int i = 0; i < TABLE_SIZE; i++)
+    unsigned int hash = 2166136261u;
+    for (int i = 0; username[i]; i++)
     {
-        User *cur = ht->table[i];
-        while (cur)
-        {
-            if (cur->role == ROLE_DOCTOR)
-            {
-                printf("Doctor: %s | Available: %s\n", cur->username, cur->available ? "Yes" : "No");
-            }
-            cur = cur->next;
-        }
+        hash ^= (unsigned char)username[i];
+        hash *= 16777619u;
     }
+    return hash_int(hash);
 }
 
-void create_reservation(User *u, hash_table *ht)
+void to_lowercase(char *str)
 {
-    view_doctors_list(ht);
-    ReservationNode *res = (ReservationNode *)malloc(sizeof(ReservationNode));
-    if (!res)
+    for (int i = 0; str[i]; i++)
     {
-        puts("Memory allocation failed.");
-        return;
+        str[i] = tolower(str[i]);
     }
+}
 
-    puts("=== Create Reservation ===");
+// Jumlah hari sejak 1970-01-01 untuk tanggal kalender Gregorian
+static int days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
 
-    printf("Enter doctor's name: ");
-    scanf(" %[^\n]", res->doctor);
+static void civil_from_days(int z, int *y, int *m, int *d)
+{
+    z += 719468;
+    int era = (z >= 0 ? z : z - 146096) / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    int doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    int mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
 
-    User *doctor = find_user(ht, res->doctor);
-    if (!doctor || doctor->role != ROLE_DOCTOR)
-    {
-        puts("Doctor not found.");
-        free(res);
-        return;
-    }
-    if (!doctor->available)
+static int parse_digits(const char *s, int n, int *out)
+{
+    int value = 0;
+    for (int i = 0; i < n; i++)
     {
-        puts("Doctor is currently unavailable.");
-        free(res);
-        return;
+        if (s[i] < '0' || s[i] > '9')
+            return 0;
+        value = value * 10 + (s[i] - '0');
     }
+    *out = value;
+    return 1;
+}
 
-    printf("Enter date (YYYY-MM-DD): ");
-    scanf("%19s", res->date);
-    getchar();
+// "YYYY-MM-DD" -> hari sejak 1970-01-01, return 0 jika tidak valid
+int parse_date(const char *date, int *days)
+{
+    static const int month_days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    int y, m, d;
+    if (strlen(date) != 10 || date[4] != '-' || date[7] != '-' ||
+        !parse_digits(date, 4, &y) || !parse_digits(date + 5, 2, &m) || !parse_digits(date + 8, 2, &d))
+        return 0;
+    if (y < MIN_YEAR || y > MAX_YEAR || m < 1 || m > 12 || d < 1)
+        return 0;
 
-    printf("Enter time (HH:MM): ");
-    scanf("%9s", res->time);
-    getchar();
+    int leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+    if (d > month_days[m - 1] + (m == 2 && leap))
+        return 0;
 
-    printf("Enter notes: ");
-    scanf(" %[^\n]", res->notes);
+    *days = days_from_civil(y, m, d);
+    return 1;
+}
 
-    res->next = NULL;
-    strcpy(res->patient_username, u->username);
-    if (u->reservations_rear == NULL)
-    {
-        u->reservations_front = u->reservations_rear = res;
-    }
-    else
-    {
-        u->reservations_rear->next = res;
-        u->reservations_rear = res;
-    }
-    save_reservations_to_csv(ht, "reservations.csv");
-    puts("Reservation created successfully!");
+// "HH:MM" -> menit sejak tengah malam, return 0 jika tidak valid
+int parse_time(const char *time, int *minutes)
+{
+    int h, m;
+    if (strlen(time) != 5 || time[2] != ':' || !parse_digits(time, 2, &h) || !parse_digits(time + 3, 2, &m))
+        return 0;
+    if (h > 23 || m > 59)
+        return 0;
+    *minutes = h * 60 + m;
+    return 1;
 }
 
-// Fungsi untuk menampilkan semua reservasi
-// yang dimiliki oleh user
-void view_reservation(User *u)
+// Key waktu reservasi: menit sejak 1970-01-01 00:00
+int make_when(const char *date, const char *time, int *when)
 {
-    AVLNode *root = NULL;
-    ReservationNode *cur = u->reservations_front;
+    int days, minutes;
+    if (!parse_date(date, &days) || !parse_time(time, &minutes))
+        return 0;
+    *when = days * MINUTES_PER_DAY + minutes;
+    return 1;
+}
 
-    while (cur)
-    {
-        root = insert_avl(root, cur);
-        cur = cur->next;
-    }
+// Menit sejak 1970-01-01 00:00 waktu lokal, skala yang sama dengan make_when
+int current_when(void)
+{
+    struct tm tm;
+    local_time_now(&tm);
+    return days_from_civil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) * MINUTES_PER_DAY +
+           tm.tm_hour * 60 + tm.tm_min;
+}
 
-    if (!root)
-    {
-        puts("No reservations found.");
-        return;
-    }
+// Nama dokter dari id hasil intern_doctor
+const char *doctor_name(int doctor_id)
+{
+    return doctor_index.by_id[doctor_id]->doctor;
+}
 
-    puts("=== Your Reservations (Sorted by Date) ===");
-    inorder_traversal_avl(root, 0);
+// Kebalikan make_when; date minimal 11 byte, time minimal 6 byte
+void format_when(int when, char *date, char *time)
+{
+    int y, m, d;
+    civil_from_days(when / MINUTES_PER_DAY, &y, &m, &d);
+    int minutes = when % MINUTES_PER_DAY;
+    sprintf(date, "%04d-%02d-%02d", y, m, d);
+    sprintf(time, "%02d:%02d", minutes / 60, minutes % 60);
+}
+
+// Bulan kalender (tahun * 12 + bulan - 1) dari key waktu
+int month_of(int when)
+{
+    int y, m, d;
+    civil_from_days(when / MINUTES_PER_DAY, &y, &m, &d);
+    return y * 12 + m - 1;
+}
+
+// Key waktu 00:00 tanggal 1 bulan tersebut
+int month_start(int month)
+{
+    return days_from_civil(month / 12, month % 12 + 1, 1) * MINUTES_PER_DAY;
+}
+
+// "YYYY-MM" -> bulan (lihat month_of), return 0 jika tidak valid
+int parse_month(const char *text, int *month)
+{
+    int y, m;
+    if (strlen(text) != 7 || text[4] != '-' || !parse_digits(text, 4, &y) || !parse_digits(text + 5, 2, &m) ||
+        y < MIN_YEAR || y > MAX_YEAR || m < 1 || m > 12)
+        return 0;
+    *month = y * 12 + m - 1;
+    return 1;
+}
+
+// "YYYY-MM"; buf minimal 11 byte seperti date di format_when
+void format_month(int month, char *buf)
+{
+    char time[6];
+    format_when(month_start(month), buf, time);
+    buf[7] = '\0';
+}
+
+int compare_reservations(ReservationNode *a, ReservationNode *b)
+{
+    return (a->when > b->when) - (a->when < b->when);
+}
+
+// Memposisikan cursor di reservasi pertama dengan when >= from
+void avl_cursor_seek(AVLCursor *c, AVLNode *root, int from)
+{
+    c->depth = 0;
+    for (AVLNode *node = root; node;)
+    {
+        if (node->res->when < from)
+        {
+            node = node->right;
+        }
+        else
+        {
+            c->stack[c->depth++] = node;
+            node = node->left;
+        }
+    }
+}
+
+ReservationNode *avl_cursor_peek(const AVLCursor *c)
+{
+    return c->depth ? c->stack[c->depth - 1]->res : NULL;
+}
+
+void avl_cursor_next(AVLCursor *c)
+{
+    AVLNode *node = c->stack[--c->depth]->right;
+    while (node)
+    {
+        c->stack[c->depth++] = node;
+        node = node->left;
+    }
+}
+
+static int compare_cursors(const AVLCursor *a, const AVLCursor *b)
+{
+    return compare_reservations(avl_cursor_peek(a), avl_cursor_peek(b));
+}
+
+void heapify_up(ReservationHeap *heap, int idx)
+{
+    AVLCursor *item = heap->data[idx];
+    while (idx > 0)
+    {
+        int parent = (idx - 1) / 2;
+        if (compare_cursors(item, heap->data[parent]) >= 0)
+            break;
+        heap->data[idx] = heap->data[parent];
+        idx = parent;
+    }
+    heap->data[idx] = item;
+}
+
+void heapify_down(ReservationHeap *heap, int idx)
+{
+    AVLCursor *item = heap->data[idx];
+    for (;;)
+    {
+        int smallest = 2 * idx + 1;
+        if (smallest >= heap->size)
+            break;
+        if (smallest + 1 < heap->size &&
+            compare_cursors(heap->data[smallest + 1], heap->data[smallest]) < 0)
+            smallest++;
+        if (compare_cursors(heap->data[smallest], item) >= 0)
+            break;
+        heap->data[idx] = heap->data[smallest];
+        idx = smallest;
+    }
+    heap->data[idx] = item;
+}
+
+void insert_heap(ReservationHeap *heap, AVLCursor *cursor)
+{
+    heap->data[heap->size] = cursor;
+    heapify_up(heap, heap->size);
+    heap->size++;
+}
+
+// Memajukan cursor di puncak heap; cursor yang habis dikeluarkan
+void advance_heap_top(ReservationHeap *heap)
+{
+    AVLCursor *top = heap->data[0];
+    avl_cursor_next(top);
+    if (!avl_cursor_peek(top))
+        heap->data[0] = heap->data[--heap->size];
+    if (heap->size > 0)
+        heapify_down(heap, 0);
+}
+
+void writer_flush(BufferedWriter *w)
+{
+    if (w->len && w->out) // out NULL: hanya menghitung, output dibuang
+        fwrite(w->buf, 1, w->len, w->out);
+    w->len = 0;
+}
+
+void writer_printf(BufferedWriter *w, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(w->buf + w->len, sizeof(w->buf) - w->len, fmt, args);
+    va_end(args);
+
+    if (n >= 0 && (size_t)n >= sizeof(w->buf) - w->len)
+    {
+        // Tidak muat: flush lalu format ulang di buffer kosong
+        writer_flush(w);
+        va_start(args, fmt);
+        n = vsnprintf(w->buf, sizeof(w->buf), fmt, args);
+        va_end(args);
+        if ((size_t)n >= sizeof(w->buf))
+            n = sizeof(w->buf) - 1;
+    }
+    if (n > 0)
+        w->len += n;
+}
+
+TrieNode *create_trie_node(const char *label, int len)
+{
+    TrieNode *node = (TrieNode *)pool_alloc(&trie_pool);
+    if (node)
+    {
+        node->children = NULL;
+        node->doctor = NULL;
+        node->rating = -1.0f;
+        node->best = -1.0f;
+        node->child_count = 0;
+        node->child_cap = 0;
+        node->label_len = (unsigned char)len;
+        memcpy(node->label, label, len);
+    }
+    return node;
+}
+
+static void free_trie_node(TrieNode *node)
+{
+    free(node->children);
+    pool_free(&trie_pool, node);
+}
+
+// Binary search child berdasarkan byte pertama label. Jika tidak ada,
+// mengembalikan posisi sisip dan *found = 0
+static int trie_child_index(const TrieNode *node, unsigned char ch, int *found)
+{
+    int lo = 0, hi = node->child_count;
+    while (lo < hi)
+    {
+        int mid = (lo + hi) / 2;
+        unsigned char c = (unsigned char)node->children[mid]->label[0];
+        if (c == ch)
+        {
+            *found = 1;
+            return mid;
+        }
+        if (c < ch)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    *found = 0;
+    return lo;
+}
+
+static int trie_add_child(TrieNode *node, int pos, TrieNode *child)
+{
+    if (node->child_count == node->child_cap)
+    {
+        int cap = node->child_cap ? node->child_cap * 2 : 2;
+        TrieNode **children = (TrieNode **)realloc(node->children, cap * sizeof(TrieNode *));
+        if (!children)
+            return 0;
+        node->children = children;
+        node->child_cap = (unsigned short)cap;
+    }
+    memmove(&node->children[pos + 1], &node->children[pos], (node->child_count - pos) * sizeof(TrieNode *));
+    node->children[pos] = child;
+    node->child_count++;
+    return 1;
+}
+
+static void trie_remove_child(TrieNode *node, int pos)
+{
+    memmove(&node->children[pos], &node->children[pos + 1], (node->child_count - pos - 1) * sizeof(TrieNode *));
+    node->child_count--;
+}
+
+static float doctor_average(const User *doctor)
+{
+    return doctor->rating_count ? (float)doctor->total_rating / doctor->rating_count : -1.0f;
+}
+
+// Hitung ulang best dari path[depth] naik ke root; berhenti lebih awal
+// kalau best sebuah node tidak berubah karena ancestor-nya juga tidak
+static void trie_refresh_path(TrieNode **path, int depth)
+{
+    for (; depth >= 0; depth--)
+    {
+        TrieNode *node = path[depth];
+        float best = node->doctor ? node->rating : -1.0f;
+        for (int i = 0; i < node->child_count; i++)
+            if (node->children[i]->best > best)
+                best = node->children[i]->best;
+        if (best == node->best && depth > 0)
+            break;
+        node->best = best;
+    }
+}
+
+// Turun mengikuti key dan mencatat node yang dilewati di path[] (path[0] =
+// root). Mengembalikan indeks node yang persis berakhir di key, atau -1
+static int trie_find_path(TrieNode *root, const char *key, TrieNode **path)
+{
+    int depth = 0;
+    path[0] = root;
+    while (*key)
+    {
+        int found;
+        TrieNode *node = path[depth];
+        int i = trie_child_index(node, (unsigned char)*key, &found);
+        if (!found)
+            return -1;
+        TrieNode *child = node->children[i];
+        if (strncmp(child->label, key, child->label_len) != 0)
+            return -1;
+        key += child->label_len;
+        path[++depth] = child;
+    }
+    return depth;
+}
+
+// Menyisipkan doctor dengan key username-nya (sudah lowercase). Edge yang
+// hanya cocok sebagian dipecah menjadi node perantara
+void insert_trie(TrieNode *root, User *doctor)
+{
+    TrieNode *path[TRIE_LABEL_MAX + 2];
+    const char *key = doctor->username;
+    int depth = 0;
+    path[0] = root;
+
+    rwlock_write_lock(&trie_lock);
+    while (*key)
+    {
+        TrieNode *cur = path[depth];
+        int found;
+        int i = trie_child_index(cur, (unsigned char)*key, &found);
+        if (!found)
+        {
+            int len = (int)strlen(key);
+            TrieNode *leaf = create_trie_node(key, len < TRIE_LABEL_MAX ? len : TRIE_LABEL_MAX);
+            if (!leaf || !trie_add_child(cur, i, leaf))
+            {
+                if (leaf)
+                    free_trie_node(leaf);
+                rwlock_write_unlock(&trie_lock);
+                return;
+            }
+            path[++depth] = leaf;
+            break;
+        }
+
+        TrieNode *child = cur->children[i];
+        int common = 0;
+        while (common < child->label_len && key[common] == child->label[common])
+            common++;
+        if (common < child->label_len)
+        {
+            TrieNode *mid = create_trie_node(child->label, common);
+            if (!mid || !trie_add_child(mid, 0, child))
+            {
+                if (mid)
+                    free_trie_node(mid);
+                rwlock_write_unlock(&trie_lock);
+                return;
+            }
+            memmove(child->label, child->label + common, child->label_len - common);
+            child->label_len -= (unsigned char)common;
+            mid->best = child->best;
+            cur->children[i] = mid;
+            child = mid;
+        }
+        key += common;
+        path[++depth] = child;
+    }
+
+    TrieNode *node = path[depth];
+    node->doctor = doctor;
+    node->rating = doctor_average(doctor);
+    trie_refresh_path(path, depth);
+    rwlock_write_unlock(&trie_lock);
+}
+
+// Melepas doctor dari tree. Node tanpa doctor yang tidak punya child dibuang,
+// yang tinggal punya satu child digabung dengan child-nya supaya tetap terkompres
+void remove_trie(TrieNode *root, User *doctor)
+{
+    TrieNode *path[TRIE_LABEL_MAX + 2];
+
+    rwlock_write_lock(&trie_lock);
+    int depth = trie_find_path(root, doctor->username, path);
+    if (depth <= 0 || path[depth]->doctor != doctor)
+    {
+        rwlock_write_unlock(&trie_lock);
+        return;
+    }
+    path[depth]->doctor = NULL;
+    path[depth]->rating = -1.0f;
+
+    while (depth > 0)
+    {
+        TrieNode *node = path[depth];
+        TrieNode *parent = path[depth - 1];
+        if (node->doctor || node->child_count > 1)
+            break;
+
+        int found;
+        int i = trie_child_index(parent, (unsigned char)node->label[0], &found);
+        if (node->child_count == 0)
+        {
+            trie_remove_child(parent, i);
+            free_trie_node(node);
+            depth--;
+            continue;
+        }
+
+        TrieNode *child = node->children[0];
+        memmove(child->label + node->label_len, child->label, child->label_len);
+        memcpy(child->label, node->label, node->label_len);
+        child->label_len += node->label_len;
+        parent->children[i] = child;
+        free_trie_node(node);
+        depth--;
+        break;
+    }
+    trie_refresh_path(path, depth);
+    rwlock_write_unlock(&trie_lock);
+}
+
+// Dipanggil setiap rating doctor berubah (caller memegang lock user doctor)
+void trie_update_rating(TrieNode *root, User *doctor, float average)
+{
+    TrieNode *path[TRIE_LABEL_MAX + 2];
+
+    rwlock_write_lock(&trie_lock);
+    int depth = trie_find_path(root, doctor->username, path);
+    if (depth > 0 && path[depth]->doctor == doctor)
+    {
+        path[depth]->rating = average;
+        trie_refresh_path(path, depth);
+    }
+    rwlock_write_unlock(&trie_lock);
+}
+
+// Mengisi rating & best seluruh tree sekaligus, setelah ratings.csv dimuat
+void trie_refresh_ratings(TrieNode *node)
+{
+    float best = -1.0f;
+    if (node->doctor)
+    {
+        node->rating = doctor_average(node->doctor);
+        best = node->rating;
+    }
+    for (int i = 0; i < node->child_count; i++)
+    {
+        trie_refresh_ratings(node->children[i]);
+        if (node->children[i]->best > best)
+            best = node->children[i]->best;
+    }
+    node->best = best;
+}
+
+// Node teratas yang semua key di bawahnya diawali prefix (prefix boleh
+// berhenti di tengah label). *exact = 1 jika prefix persis nama dokter.
+// Caller memegang trie_lock
+TrieNode *trie_find_prefix(TrieNode *root, const char *prefix, int *exact)
+{
+    TrieNode *cur = root;
+    *exact = 0;
+    while (*prefix)
+    {
+        int found;
+        int i = trie_child_index(cur, (unsigned char)*prefix, &found);
+        if (!found)
+            return NULL;
+        TrieNode *child = cur->children[i];
+        int n = 0;
+        while (n < child->label_len && prefix[n] && prefix[n] == child->label[n])
+            n++;
+        if (prefix[n] == '\0' && n < child->label_len)
+            return child; // prefix habis di tengah edge
+        if (n < child->label_len)
+            return NULL;
+        prefix += n;
+        cur = child;
+    }
+    *exact = cur->doctor != NULL;
+    return cur;
+}
+
+static void trie_heap_push(TrieHeapItem **items, int *count, int *cap, TrieHeapItem item)
+{
+    if (*count == *cap)
+    {
+        int new_cap = *cap ? *cap * 2 : 32;
+        TrieHeapItem *grown = (TrieHeapItem *)realloc(*items, new_cap * sizeof(TrieHeapItem));
+        if (!grown)
+            return;
+        *items = grown;
+        *cap = new_cap;
+    }
+    int i = (*count)++;
+    while (i > 0 && (*items)[(i - 1) / 2].key < item.key)
+    {
+        (*items)[i] = (*items)[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    (*items)[i] = item;
+}
+
+static TrieHeapItem trie_heap_pop(TrieHeapItem *items, int *count)
+{
+    TrieHeapItem top = items[0];
+    TrieHeapItem last = items[--(*count)];
+    int i = 0;
+    for (;;)
+    {
+        int child = i * 2 + 1;
+        if (child >= *count)
+            break;
+        if (child + 1 < *count && items[child + 1].key > items[child].key)
+            child++;
+        if (items[child].key <= last.key)
+            break;
+        items[i] = items[child];
+        i = child;
+    }
+    if (*count > 0)
+        items[i] = last;
+    return top;
+}
+
+// K dokter dengan rating tertinggi di subtree start, urut menurun (dokter
+// tanpa rating di akhir). Best-first: subtree baru dibuka ketika best-nya
+// paling tinggi di heap, jadi cabang yang tidak mungkin masuk K teratas
+// tidak pernah dikunjungi. Caller memegang trie_lock
+int trie_top_k(TrieNode *start, TrieNode **out, int k)
+{
+    TrieHeapItem *items = NULL;
+    int count = 0, cap = 0, found = 0;
+
+    TrieHeapItem first = {start->best, start, 0};
+    trie_heap_push(&items, &count, &cap, first);
+    while (count > 0 && found < k)
+    {
+        TrieHeapItem top = trie_heap_pop(items, &count);
+        if (top.terminal)
+        {
+            out[found++] = top.node;
+            continue;
+        }
+        if (top.node->doctor)
+        {
+            TrieHeapItem self = {top.node->rating, top.node, 1};
+            trie_heap_push(&items, &count, &cap, self);
+        }
+        for (int i = 0; i < top.node->child_count; i++)
+        {
+            TrieHeapItem sub = {top.node->children[i]->best, top.node->children[i], 0};
+            trie_heap_push(&items, &count, &cap, sub);
+        }
+    }
+    free(items);
+    return found;
+}
+
+// Jarak slot dari posisi ideal hash-nya
+static int probe_distance(const hash_table *ht, unsigned int hash, int slot)
+{
+    return (slot - (int)(hash & (unsigned int)(ht->capacity - 1))) & (ht->capacity - 1);
+}
+
+// Menaruh user ke slot kosong dengan Robin Hood probing:
+// entry yang lebih "miskin" (lebih jauh dari posisi idealnya) merebut slot
+static void place_user_slot(hash_table *ht, unsigned int hash, User *u)
+{
+    int mask = ht->capacity - 1;
+    int idx = (int)(hash & (unsigned int)mask);
+    int dist = 0;
+
+    while (ht->slots[idx].user)
+    {
+        int existing = probe_distance(ht, ht->slots[idx].hash, idx);
+        if (existing < dist)
+        {
+            UserSlot tmp = ht->slots[idx];
+            ht->slots[idx].hash = hash;
+            ht->slots[idx].user = u;
+            hash = tmp.hash;
+            u = tmp.user;
+            dist = existing;
+        }
+        idx = (idx + 1) & mask;
+        dist++;
+    }
+    ht->slots[idx].hash = hash;
+    ht->slots[idx].user = u;
+}
+
+static int resize_table(hash_table *ht, int new_capacity)
+{
+    UserSlot *old_slots = ht->slots;
+    int old_capacity = ht->capacity;
+
+    UserSlot *slots = (UserSlot *)calloc(new_capacity, sizeof(UserSlot));
+    if (!slots)
+        return 0;
+
+    ht->slots = slots;
+    ht->capacity = new_capacity;
+    for (int i = 0; i < old_capacity; i++)
+    {
+        if (old_slots[i].user)
+            place_user_slot(ht, old_slots[i].hash, old_slots[i].user);
+    }
+    free(old_slots);
+    return 1;
+}
+
+// Mencari index slot milik username, -1 jika tidak ada.
+// Pencarian berhenti begitu jarak probe melewati jarak entry di slot,
+// karena Robin Hood menjamin key tidak mungkin ada setelah titik itu
+static int find_user_slot(const hash_table *ht, const char *username, unsigned int hash)
+{
+    if (ht->capacity == 0)
+        return -1;
+
+    int mask = ht->capacity - 1;
+    int idx = (int)(hash & (unsigned int)mask);
+    for (int dist = 0; ht->slots[idx].user; dist++)
+    {
+        if (probe_distance(ht, ht->slots[idx].hash, idx) < dist)
+            return -1;
+        if (ht->slots[idx].hash == hash && strcmp(ht->slots[idx].user->username, username) == 0)
+            return idx;
+        idx = (idx + 1) & mask;
+    }
+    return -1;
+}
+
+// Memastikan tabel cukup besar untuk n user tanpa resize berulang
+void reserve_user_table(hash_table *ht, int n)
+{
+    int capacity = ht->capacity ? ht->capacity : TABLE_INITIAL_CAPACITY;
+    while (n * TABLE_MAX_LOAD_DEN > capacity * TABLE_MAX_LOAD_NUM)
+        capacity *= 2;
+    if (capacity != ht->capacity)
+        resize_table(ht, capacity);
+}
+
+// Memastikan user_index muat id 0..n-1. User dari clinic.snap dibuat
+// di bawah read lock, jadi kapasitasnya dipesan di depan (snapshot_open)
+// supaya by_id tidak pernah di-realloc saat dibaca thread lain
+int reserve_user_index(int n)
+{
+    UserIndex *index = &user_index;
+    if (n <= index->capacity)
+        return 1;
+    int capacity = index->capacity ? index->capacity : TABLE_INITIAL_CAPACITY;
+    while (capacity < n)
+        capacity *= 2;
+    User **by_id = (User **)realloc(index->by_id, capacity * sizeof(User *));
+    if (!by_id)
+        return 0;
+    memset(by_id + index->capacity, 0, (capacity - index->capacity) * sizeof(User *));
+    index->by_id = by_id;
+    index->capacity = capacity;
+    return 1;
+}
+
+// Lookup ke clinic.snap untuk username yang belum ada di tabel (lihat
+// [BINARY SNAPSHOT]). User yang ketemu langsung dimasukkan ke tabel
+User *snapshot_find_user(hash_table *ht, const char *username, unsigned int hash);
+
+// Menambah user baru (belum ada di tabel) dengan field rating kosong
+static User *add_user_slot(hash_table *ht, const char *username, unsigned int hash, int id)
+{
+    if (ht->capacity == 0 ||
+        (ht->count + 1) * TABLE_MAX_LOAD_DEN > ht->capacity * TABLE_MAX_LOAD_NUM)
+    {
+        int new_capacity = ht->capacity ? ht->capacity * 2 : TABLE_INITIAL_CAPACITY;
+        if (!resize_table(ht, new_capacity))
+        {
+            puts("Memory allocation failed");
+            return NULL;
+        }
+    }
+
+    User *u = reserve_user_index(id + 1) ? (User *)pool_alloc(&user_pool) : NULL;
+    if (!u)
+    {
+        puts("Memory allocation failed");
+        return NULL;
+    }
+    strncpy(u->username, username, sizeof(u->username) - 1);
+    u->username[sizeof(u->username) - 1] = '\0';
+    u->reservations = NULL;
+
+    u->total_rating = 0; // Initialize total rating
+    u->rating_count = 0; // Initialize rating count
+    memset(u->rating_hist, 0, sizeof(u->rating_hist));
+    u->rating_days = NULL;
+    u->id = id;
+    __atomic_store_n(&user_index.by_id[id], u, __ATOMIC_RELEASE);
+    if (id >= user_index.count)
+        user_index.count = id + 1;
+
+    place_user_slot(ht, hash, u);
+    ht->count++;
+    return u;
+}
+
+// Insert dengan hash yang sudah dihitung (dipakai loader paralel)
+// Jika username sudah ada, data user lama ditimpa (password & role)
+// sehingga akun bawaan tetap menggantikan data dari CSV
+User *insert_user_hashed(hash_table *ht, const char *username, unsigned int hash, const char *password, int role)
+{
+    int slot = find_user_slot(ht, username, hash);
+    User *u = slot >= 0 ? ht->slots[slot].user : snapshot_find_user(ht, username, hash);
+    if (!u && !(u = add_user_slot(ht, username, hash, user_index.count)))
+        return NULL;
+
+    strncpy(u->password, password, sizeof(u->password) - 1);
+    u->password[sizeof(u->password) - 1] = '\0';
+
+    u->role = role;
+    u->available = (role == ROLE_DOCTOR) ? 1 : 0;
+    return u;
+}
+
+// Function untuk insert user ke hash table
+void insert_user(hash_table *ht, const char *username, const char *password, int role)
+{
+    insert_user_hashed(ht, username, hash_function(username), password, role);
+}
+
+User *find_user_hashed(hash_table *ht, const char *username, unsigned int hash)
+{
+    int slot = find_user_slot(ht, username, hash);
+    return slot >= 0 ? ht->slots[slot].user : snapshot_find_user(ht, username, hash);
+}
+
+// Function untuk mencari user berdasarkan username
+User *find_user(hash_table *ht, const char *username)
+{
+    int64_t started = metric_start_sampled();
+    User *u = find_user_hashed(ht, username, hash_function(username));
+    metric_stop(METRIC_FIND_USER, started);
+    return u;
+}
+
+// Username dari id user. Pasien yang reservasinya sudah dimuat lewat
+// jadwal dokter bisa saja belum dibuat dari clinic.snap: namanya dibaca
+// langsung dari record snapshot (sudah dicek snapshot_node)
+const char *user_name(int id)
+{
+    User *u = __atomic_load_n(&user_index.by_id[id], __ATOMIC_ACQUIRE);
+    if (u)
+        return u->username;
+    return __atomic_load_n(&snapshot.header, __ATOMIC_ACQUIRE) ? snapshot.users[id].username : "?";
+}
+
+// Fungsi untuk AVL
+
+int height(AVLNode *node)
+{
+    return node ? node->height : 0;
+}
+
+int max(int a, int b)
+{
+    return (a > b) ? a : b;
+}
+
+int get_balance(AVLNode *node)
+{
+    if (!node)
+        return 0;
+    return height(node->left) - height(node->right);
+}
+
+int avl_size(AVLNode *node)
+{
+    return node ? node->size : 0;
+}
+
+// Menghitung ulang height dan size dari kedua anak
+void update_avl_node(AVLNode *node)
+{
+    node->height = max(height(node->left), height(node->right)) + 1;
+    node->size = avl_size(node->left) + avl_size(node->right) + 1;
+}
+
+// Rotation
+AVLNode *right_rotate(AVLNode *y)
+{
+    AVLNode *x = y->left;
+    AVLNode *T2 = x->right;
+
+    x->right = y;
+    y->left = T2;
+
+    update_avl_node(y);
+    update_avl_node(x);
+
+    return x;
+}
+
+AVLNode *left_rotate(AVLNode *x)
+{
+    AVLNode *y = x->right;
+    AVLNode *T2 = y->left;
+
+    y->left = x;
+    x->right = T2;
+
+    update_avl_node(x);
+    update_avl_node(y);
+
+    return y;
+}
+
+void inorder_traversal_avl(AVLNode *node, int is_doctor_view, FILE *out)
+{
+    if (!node)
+        return;
+
+    inorder_traversal_avl(node->left, is_doctor_view, out);
+
+    ReservationNode *res = node->res;
+    if (is_doctor_view)
+    {
+        fprintf(out, "Patient: %s\n", user_name(res->patient_id));
+    }
+
+    char date[11], time[6];
+    format_when(res->when, date, time);
+    fprintf(out, "Date: %s\nTime: %s\nDoctor: %s\nNotes: %s\n\n",
+            date, time, doctor_name(res->doctor_id), res->notes);
+
+    inorder_traversal_avl(node->right, is_doctor_view, out);
+}
+
+// Rebalance satu node setelah insert/delete di subtree-nya.
+// Kasus rotasi ditentukan dari balance anak, bukan dari key
+AVLNode *rebalance_avl(AVLNode *node)
+{
+    update_avl_node(node);
+    int balance = get_balance(node);
+
+    if (balance > 1)
+    {
+        if (get_balance(node->left) < 0)
+            node->left = left_rotate(node->left);
+        return right_rotate(node);
+    }
+    if (balance < -1)
+    {
+        if (get_balance(node->right) > 0)
+            node->right = right_rotate(node->right);
+        return left_rotate(node);
+    }
+    return node;
+}
+
+// Key lengkap reservasi di AVL pasien maupun jadwal dokter:
+// waktu (tanggal + jam), dokter, lalu pasien
+int compare_reservation_key(ReservationNode *a, ReservationNode *b)
+{
+    int cmp = compare_reservations(a, b);
+    if (cmp == 0)
+        cmp = (a->doctor_id > b->doctor_id) - (a->doctor_id < b->doctor_id);
+    if (cmp == 0)
+        cmp = (a->patient_id > b->patient_id) - (a->patient_id < b->patient_id);
+    return cmp;
+}
+
+// Urutan node di AVL: key lengkap, lalu alamat node sebagai tie-break
+// supaya duplikat key tetap punya posisi pasti (dan bisa dihapus tepat)
+static int compare_avl_node(ReservationNode *a, ReservationNode *b)
+{
+    int cmp = compare_reservation_key(a, b);
+    if (cmp == 0)
+        cmp = ((uintptr_t)a > (uintptr_t)b) - ((uintptr_t)a < (uintptr_t)b);
+    return cmp;
+}
+
+static AVLNode *insert_avl_node(AVLNode *node, ReservationNode *res, int mode, int *inserted)
+{
+    if (!node)
+    {
+        AVLNode *new_node = (AVLNode *)pool_alloc(&avl_pool);
+        *inserted = new_node != NULL;
+        if (!new_node)
+            return NULL;
+        new_node->res = res;
+        new_node->left = new_node->right = NULL;
+        new_node->height = 1;
+        new_node->size = 1;
+        return new_node;
+    }
+
+    int cmp = compare_reservation_key(res, node->res);
+    if (cmp == 0)
+    {
+        if (mode == AVL_UNIQUE)
+        {
+            *inserted = 0;
+            return node;
+        }
+        cmp = compare_avl_node(res, node->res);
+        if (cmp == 0) // node yang sama dimasukkan dua kali
+        {
+            *inserted = 0;
+            return node;
+        }
+    }
+
+    if (cmp < 0)
+        node->left = insert_avl_node(node->left, res, mode, inserted);
+    else
+        node->right = insert_avl_node(node->right, res, mode, inserted);
+
+    return rebalance_avl(node);
+}
+
+// Insert reservasi ke AVL. Dengan AVL_UNIQUE, reservasi yang key-nya
+// sudah ada ditolak; dengan AVL_ALLOW_DUPLICATES tetap disimpan.
+// *inserted diisi 1 jika node baru masuk, 0 jika ditolak / gagal alokasi
+AVLNode *insert_avl(AVLNode *node, ReservationNode *res, int mode, int *inserted)
+{
+    int64_t started = metric_start_sampled();
+    node = insert_avl_node(node, res, mode, inserted);
+    metric_stop(METRIC_INSERT_AVL, started);
+    return node;
+}
+
+// Menghapus node milik reservasi res (dicocokkan per alamat, bukan key)
+AVLNode *delete_avl(AVLNode *node, ReservationNode *res)
+{
+    if (!node)
+        return NULL;
+
+    int cmp = compare_avl_node(res, node->res);
+    if (cmp < 0)
+    {
+        node->left = delete_avl(node->left, res);
+    }
+    else if (cmp > 0)
+    {
+        node->right = delete_avl(node->right, res);
+    }
+    else
+    {
+        if (!node->left || !node->right)
+        {
+            AVLNode *child = node->left ? node->left : node->right;
+            pool_free(&avl_pool, node);
+            return child;
+        }
+
+        // Ganti dengan successor lalu hapus successor dari subtree kanan
+        AVLNode *succ = node->right;
+        while (succ->left)
+            succ = succ->left;
+        node->res = succ->res;
+        node->right = delete_avl(node->right, succ->res);
+    }
+
+    return rebalance_avl(node);
+}
+
+// Node ke-k (mulai 0) dalam urutan in-order, NULL jika di luar jangkauan
+AVLNode *avl_select(AVLNode *node, int k)
+{
+    while (node)
+    {
+        int left = avl_size(node->left);
+        if (k < left)
+        {
+            node = node->left;
+        }
+        else if (k == left)
+        {
+            return node;
+        }
+        else
+        {
+            k -= left + 1;
+            node = node->right;
+        }
+    }
+    return NULL;
+}
+
+// Jumlah node dengan when < bound (rank di urutan waktu), O(log n)
+int avl_count_before(AVLNode *node, int bound)
+{
+    int count = 0;
+    while (node)
+    {
+        if (node->res->when < bound)
+        {
+            count += avl_size(node->left) + 1;
+            node = node->right;
+        }
+        else
+        {
+            node = node->left;
+        }
+    }
+    return count;
+}
+
+// Jumlah reservasi dengan from <= when <= to dari selisih dua rank,
+// tanpa menelusuri reservasinya
+int avl_count_range(AVLNode *root, int from, int to)
+{
+    if (from > to)
+        return 0;
+    int upto = to == INT_MAX ? avl_size(root) : avl_count_before(root, to + 1);
+    return upto - avl_count_before(root, from);
+}
+
+void free_avl(AVLNode *node)
+{
+    if (!node)
+        return;
+    free_avl(node->left);
+    free_avl(node->right);
+    pool_free(&avl_pool, node);
+}
+
+#ifdef CLINIC_DEBUG
+// Memeriksa seluruh invariant AVL (urutan, height, size, balance).
+// lo/hi = batas key dari ancestor, NULL jika tidak ada. Return height
+static int avl_check_node(AVLNode *node, ReservationNode *lo, ReservationNode *hi)
+{
+    if (!node)
+        return 0;
+
+    if ((lo && compare_avl_node(lo, node->res) >= 0) ||
+        (hi && compare_avl_node(node->res, hi) >= 0))
+    {
+        fprintf(stderr, "AVL invariant: urutan key rusak\n");
+        abort();
+    }
+
+    int lh = avl_check_node(node->left, lo, node->res);
+    int rh = avl_check_node(node->right, node->res, hi);
+    if (node->height != max(lh, rh) + 1 || lh - rh > 1 || rh - lh > 1 ||
+        node->size != avl_size(node->left) + avl_size(node->right) + 1)
+    {
+        fprintf(stderr, "AVL invariant: height/balance/size rusak (h=%d, kiri=%d, kanan=%d)\n",
+                node->height, lh, rh);
+        abort();
+    }
+    return node->height;
+}
+
+#define AVL_CHECK(root) ((void)avl_check_node((root), NULL, NULL))
+#else
+#define AVL_CHECK(root) ((void)0)
+#endif
+
+// ======================= [DOCTOR INDEX] =======================
+
+static int grow_doctor_index(DoctorIndex *index)
+{
+    int new_capacity = index->capacity ? index->capacity * 2 : 16;
+    DoctorSchedule **slots = (DoctorSchedule **)calloc(new_capacity, sizeof(DoctorSchedule *));
+    if (!slots)
+        return 0;
+
+    for (int i = 0; i < index->capacity; i++)
+    {
+        DoctorSchedule *s = index->slots[i];
+        if (!s)
+            continue;
+        int idx = (int)(s->hash & (unsigned int)(new_capacity - 1));
+        while (slots[idx])
+            idx = (idx + 1) & (new_capacity - 1);
+        slots[idx] = s;
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = new_capacity;
+    return 1;
+}
+
+// Mencari jadwal dokter, dibuat baru jika create != 0
+DoctorSchedule *find_doctor_schedule(const char *doctor, int create)
+{
+    DoctorIndex *index = &doctor_index;
+    unsigned int hash = hash_function(doctor);
+
+    if (index->capacity)
+    {
+        int mask = index->capacity - 1;
+        for (int idx = (int)(hash & (unsigned int)mask); index->slots[idx]; idx = (idx + 1) & mask)
+        {
+            DoctorSchedule *s = index->slots[idx];
+            if (s->hash == hash && strcmp(s->doctor, doctor) == 0)
+                return s;
+        }
+    }
+    if (!create)
+        return NULL;
+
+    if ((index->count + 1) * 2 > index->capacity && !grow_doctor_index(index))
+        return NULL;
+    if (index->count == index->by_id_capacity)
+    {
+        int capacity = index->by_id_capacity ? index->by_id_capacity * 2 : 16;
+        DoctorSchedule **by_id = (DoctorSchedule **)realloc(index->by_id, capacity * sizeof(DoctorSchedule *));
+        if (!by_id)
+            return NULL;
+        index->by_id = by_id;
+        index->by_id_capacity = capacity;
+    }
+
+    DoctorSchedule *s = (DoctorSchedule *)malloc(sizeof(DoctorSchedule));
+    if (!s)
+        return NULL;
+    strncpy(s->doctor, doctor, sizeof(s->doctor) - 1);
+    s->doctor[sizeof(s->doctor) - 1] = '\0';
+    s->hash = hash;
+    s->id = index->count;
+    s->appointments = NULL;
+    s->calendar.days = NULL;
+    s->calendar.capacity = s->calendar.count = 0;
+    mutex_init(&s->lock);
+    s->snapshot_pending = 0;
+
+    int mask = index->capacity - 1;
+    int idx = (int)(hash & (unsigned int)mask);
+    while (index->slots[idx])
+        idx = (idx + 1) & mask;
+    index->slots[idx] = s;
+    index->by_id[s->id] = s;
+    index->count++;
+    return s;
+}
+
+// Mengubah nama dokter menjadi id padat, -1 jika gagal alokasi
+int intern_doctor(const char *doctor)
+{
+    DoctorSchedule *s = find_doctor_schedule(doctor, 1);
+    return s ? s->id : -1;
+}
+
+static int grow_calendar(SlotCalendar *cal)
+{
+    int new_capacity = cal->capacity ? cal->capacity * 2 : 16;
+    DaySlots *days = (DaySlots *)malloc(new_capacity * sizeof(DaySlots));
+    if (!days)
+        return 0;
+    for (int i = 0; i < new_capacity; i++)
+        days[i].day = -1;
+
+    for (int i = 0; i < cal->capacity; i++)
+    {
+        if (cal->days[i].day < 0)
+            continue;
+        int idx = (int)(hash_int((unsigned int)cal->days[i].day) & (unsigned int)(new_capacity - 1));
+        while (days[idx].day >= 0)
+            idx = (idx + 1) & (new_capacity - 1);
+        days[idx] = cal->days[i];
+    }
+    free(cal->days);
+    cal->days = days;
+    cal->capacity = new_capacity;
+    return 1;
+}
+
+// Bitmap hari tertentu, dibuat kosong jika create != 0.
+// NULL berarti hari itu belum punya slot terisi (atau gagal alokasi)
+static DaySlots *find_day_slots(SlotCalendar *cal, int day, int create)
+{
+    if (cal->capacity)
+    {
+        int mask = cal->capacity - 1;
+        for (int idx = (int)(hash_int((unsigned int)day) & (unsigned int)mask); cal->days[idx].day >= 0;
+             idx = (idx + 1) & mask)
+        {
+            if (cal->days[idx].day == day)
+                return &cal->days[idx];
+        }
+    }
+    if (!create)
+        return NULL;
+
+    if ((cal->count + 1) * 2 > cal->capacity && !grow_calendar(cal))
+        return NULL;
+
+    int mask = cal->capacity - 1;
+    int idx = (int)(hash_int((unsigned int)day) & (unsigned int)mask);
+    while (cal->days[idx].day >= 0)
+        idx = (idx + 1) & mask;
+    cal->days[idx].day = day;
+    memset(cal->days[idx].used, 0, sizeof(cal->days[idx].used));
+    cal->count++;
+    return &cal->days[idx];
+}
+
+// 1 jika slot yang memuat waktu when sudah terisi, O(1)
+int slot_is_taken(DoctorSchedule *s, int when)
+{
+    DaySlots *d = find_day_slots(&s->calendar, when / MINUTES_PER_DAY, 0);
+    int slot = when % MINUTES_PER_DAY / SLOT_MINUTES;
+    return d && (d->used[slot / 64] >> (slot % 64) & 1);
+}
+
+// Jumlah slot kosong pada hari day
+int free_slots_on_day(DoctorSchedule *s, int day)
+{
+    DaySlots *d = find_day_slots(&s->calendar, day, 0);
+    int taken = 0;
+    for (int w = 0; d && w < SLOT_WORDS; w++)
+        taken += __builtin_popcountll(d->used[w]);
+    return SLOTS_PER_DAY - taken;
+}
+
+// Awal slot kosong pertama pada atau setelah when. Hari yang belum
+// punya bitmap pasti kosong, jadi loop berhenti paling lambat setelah
+// melewati semua hari yang sudah penuh
+int next_free_slot(DoctorSchedule *s, int when)
+{
+    int day = when / MINUTES_PER_DAY;
+    int slot = when % MINUTES_PER_DAY / SLOT_MINUTES;
+    if (when % SLOT_MINUTES)
+        slot++; // slot yang sudah berjalan tidak dihitung
+
+    for (;; day++, slot = 0)
+    {
+        DaySlots *d = find_day_slots(&s->calendar, day, 0);
+        if (!d)
+            return slot < SLOTS_PER_DAY ? day * MINUTES_PER_DAY + slot * SLOT_MINUTES
+                                        : (day + 1) * MINUTES_PER_DAY;
+
+        for (int w = slot / 64; w < SLOT_WORDS; w++)
+        {
+            uint64_t free_bits = ~d->used[w];
+            if (w == slot / 64)
+                free_bits &= ~0ULL << (slot % 64);
+            if (w == SLOT_WORDS - 1 && SLOTS_PER_DAY % 64)
+                free_bits &= (1ULL << (SLOTS_PER_DAY % 64)) - 1;
+            if (free_bits)
+                return day * MINUTES_PER_DAY + (w * 64 + __builtin_ctzll(free_bits)) * SLOT_MINUTES;
+        }
+    }
+}
+
+static void slot_mark(DoctorSchedule *s, int when)
+{
+    DaySlots *d = find_day_slots(&s->calendar, when / MINUTES_PER_DAY, 1);
+    int slot = when % MINUTES_PER_DAY / SLOT_MINUTES;
+    if (d)
+        d->used[slot / 64] |= 1ULL << (slot % 64);
+}
+
+// Bit hanya dikosongkan jika tidak ada reservasi lain di slot yang sama
+// (duplikat dari file tetap dimuat, lihat doctor_schedule_add)
+static void slot_release(DoctorSchedule *s, int when)
+{
+    int start = when - when % SLOT_MINUTES;
+    AVLCursor cursor;
+    avl_cursor_seek(&cursor, s->appointments, start);
+    ReservationNode *next = avl_cursor_peek(&cursor);
+    if (next && next->when < start + SLOT_MINUTES)
+        return;
+
+    DaySlots *d = find_day_slots(&s->calendar, when / MINUTES_PER_DAY, 0);
+    int slot = when % MINUTES_PER_DAY / SLOT_MINUTES;
+    if (d)
+        d->used[slot / 64] &= ~(1ULL << (slot % 64));
+}
+
+// Dipanggil setiap kali reservasi masuk ke AVL pasien. Bentrok dari
+// file/journal tidak ditolak di sini; hanya slot-nya ditandai terisi
+void doctor_schedule_add(ReservationNode *res)
+{
+    DoctorSchedule *s = doctor_index.by_id[res->doctor_id];
+    int inserted;
+    s->appointments = insert_avl(s->appointments, res, AVL_ALLOW_DUPLICATES, &inserted);
+    AVL_CHECK(s->appointments);
+    slot_mark(s, res->when);
+}
+
+// Dipanggil sebelum reservasi di-free (cancel / hapus user)
+void doctor_schedule_remove(ReservationNode *res)
+{
+    DoctorSchedule *s = doctor_index.by_id[res->doctor_id];
+    if (res->snapshot_row >= 0 && snapshot.nodes)
+    {
+        snapshot.nodes[res->snapshot_row] = SNAPSHOT_ROW_GONE;
+        if (s->snapshot_pending)
+            return; // belum pernah masuk jadwal, jangan dimuat lagi nanti
+    }
+    s->appointments = delete_avl(s->appointments, res);
+    AVL_CHECK(s->appointments);
+    slot_release(s, res->when);
+}
+
+// ======================= [RESERVATION STORE] =======================
+// Kolom reservasi dirawat bersamaan dengan AVL pasien & jadwal dokter
+// (add_reservation / remove_reservation). Lock sendiri karena booking
+// ke dokter berbeda berjalan paralel
+
+static int store_grow(ReservationStore *st)
+{
+    int capacity = st->capacity ? st->capacity * 2 : 1024;
+    int *when = (int *)realloc(st->when, capacity * sizeof(int));
+    if (when)
+        st->when = when;
+    int *doctor_id = (int *)realloc(st->doctor_id, capacity * sizeof(int));
+    if (doctor_id)
+        st->doctor_id = doctor_id;
+    int *patient_id = (int *)realloc(st->patient_id, capacity * sizeof(int));
+    if (patient_id)
+        st->patient_id = patient_id;
+    ReservationNode **node = (ReservationNode **)realloc(st->node, capacity * sizeof(ReservationNode *));
+    if (node)
+        st->node = node;
+    if (!when || !doctor_id || !patient_id || !node)
+        return 0; // kolom yang berhasil tumbuh tetap dipakai, capacity lama
+    st->capacity = capacity;
+    return 1;
+}
+
+void store_add(ReservationNode *res)
+{
+    ReservationStore *st = &reservation_store;
+    mutex_lock(&st->lock);
+    if (st->count == st->capacity && !store_grow(st))
+    {
+        res->store_row = -1; // analitik tidak lengkap, reservasi tetap jalan
+        mutex_unlock(&st->lock);
+        return;
+    }
+    int row = st->count++;
+    st->when[row] = res->when;
+    st->doctor_id[row] = res->doctor_id;
+    st->patient_id[row] = res->patient_id;
+    st->node[row] = res;
+    res->store_row = row;
+    int inserted; // gagal alokasi: query rentang tidak lengkap, sama seperti di atas
+    st->by_time = insert_avl(st->by_time, res, AVL_ALLOW_DUPLICATES, &inserted);
+    AVL_CHECK(st->by_time);
+    mutex_unlock(&st->lock);
+}
+
+void store_remove(ReservationNode *res)
+{
+    ReservationStore *st = &reservation_store;
+    mutex_lock(&st->lock);
+    int row = res->store_row; // bisa berubah oleh swap-remove lain, baca di bawah lock
+    if (row < 0)
+    {
+        mutex_unlock(&st->lock);
+        return;
+    }
+    int last = --st->count;
+    if (row != last)
+    {
+        st->when[row] = st->when[last];
+        st->doctor_id[row] = st->doctor_id[last];
+        st->patient_id[row] = st->patient_id[last];
+        st->node[row] = st->node[last];
+        st->node[row]->store_row = row;
+    }
+    res->store_row = -1;
+    st->by_time = delete_avl(st->by_time, res);
+    AVL_CHECK(st->by_time);
+    mutex_unlock(&st->lock);
+}
+
+// Kunci grup per baris: doctor_id * days + (hari - from_day), atau `cells`
+// (sel buangan) untuk baris di luar rentang. Tanpa cabang supaya compiler
+// bisa mem-vectorize; penjumlahan ke histogram dilakukan terpisah
+static void store_day_keys(const int *when, const int *doctor_id, int n, int from_day, int days,
+                           int doctors, int *keys)
+{
+    int cells = doctors * days;
+    for (int i = 0; i < n; i++)
+    {
+        int day = when[i] / MINUTES_PER_DAY - from_day;
+        int in_range = ((unsigned)day < (unsigned)days) & ((unsigned)doctor_id[i] < (unsigned)doctors);
+        keys[i] = in_range ? doctor_id[i] * days + day : cells;
+    }
+}
+
+// Sama seperti store_day_keys, tapi kunci = jam (0..23)
+static void store_hour_keys(const int *when, int n, int from_day, int days, int *keys)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int day = when[i] / MINUTES_PER_DAY - from_day;
+        int hour = when[i] % MINUTES_PER_DAY / 60;
+        keys[i] = (unsigned)day < (unsigned)days ? hour : 24;
+    }
+}
+
+// Jumlah booking per (dokter, hari) untuk hari [from_day, from_day + days).
+// counts minimal doctors * days + 1 elemen (elemen terakhir = sel buangan)
+void store_count_by_doctor_day(int from_day, int days, int doctors, int *counts)
+{
+    ReservationStore *st = &reservation_store;
+    int keys[STORE_SCAN_BLOCK];
+    memset(counts, 0, ((size_t)doctors * days + 1) * sizeof(int));
+
+    mutex_lock(&st->lock);
+    for (int base = 0; base < st->count; base += STORE_SCAN_BLOCK)
+    {
+        int n = st->count - base < STORE_SCAN_BLOCK ? st->count - base : STORE_SCAN_BLOCK;
+        store_day_keys(st->when + base, st->doctor_id + base, n, from_day, days, doctors, keys);
+        for (int i = 0; i < n; i++)
+            counts[keys[i]]++;
+    }
+    mutex_unlock(&st->lock);
+}
+
+// Jumlah booking per jam mulai (0..23) dalam rentang hari. counts[25]
+void store_count_by_hour(int from_day, int days, int *counts)
+{
+    ReservationStore *st = &reservation_store;
+    int keys[STORE_SCAN_BLOCK];
+    memset(counts, 0, 25 * sizeof(int));
+
+    mutex_lock(&st->lock);
+    for (int base = 0; base < st->count; base += STORE_SCAN_BLOCK)
+    {
+        int n = st->count - base < STORE_SCAN_BLOCK ? st->count - base : STORE_SCAN_BLOCK;
+        store_hour_keys(st->when + base, n, from_day, days, keys);
+        for (int i = 0; i < n; i++)
+            counts[keys[i]]++;
+    }
+    mutex_unlock(&st->lock);
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Jumlah pasien berbeda per dokter dalam rentang hari: pasangan
+// (dokter, pasien) dikumpulkan, diurutkan, lalu dihitung yang unik
+void store_unique_patients(int from_day, int days, int doctors, int *unique)
+{
+    ReservationStore *st = &reservation_store;
+    memset(unique, 0, doctors * sizeof(int));
+
+    mutex_lock(&st->lock);
+    uint64_t *pairs = (uint64_t *)malloc((st->count ? st->count : 1) * sizeof(uint64_t));
+    int n = 0;
+    for (int i = 0; pairs && i < st->count; i++)
+    {
+        int day = st->when[i] / MINUTES_PER_DAY - from_day;
+        if ((unsigned)day < (unsigned)days && (unsigned)st->doctor_id[i] < (unsigned)doctors)
+            pairs[n++] = (uint64_t)st->doctor_id[i] << 32 | (uint32_t)st->patient_id[i];
+    }
+    mutex_unlock(&st->lock);
+    if (!pairs)
+        return;
+
+    qsort(pairs, n, sizeof(uint64_t), compare_u64);
+    for (int i = 0; i < n; i++)
+    {
+        if (i == 0 || pairs[i] != pairs[i - 1])
+            unique[pairs[i] >> 32]++;
+    }
+    free(pairs);
+}
+
+// ======================= [RESERVATION CORE] =======================
+
+// Menambahkan reservasi ke AVL milik pasien dan ke jadwal dokter.
+// Return 0 (reservasi tidak dipakai) jika ditolak karena duplikat
+// pada mode AVL_UNIQUE atau gagal alokasi
+int add_reservation(User *u, ReservationNode *res, int mode)
+{
+    int inserted;
+    u->reservations = insert_avl(u->reservations, res, mode, &inserted);
+    AVL_CHECK(u->reservations);
+    if (!inserted)
+        return 0;
+    doctor_schedule_add(res);
+    store_add(res);
+    return 1;
+}
+
+// Melepas reservasi dari AVL pasien dan jadwal dokter lalu di-free
+void remove_reservation(User *u, ReservationNode *res)
+{
+    u->reservations = delete_avl(u->reservations, res);
+    AVL_CHECK(u->reservations);
+    doctor_schedule_remove(res);
+    store_remove(res);
+    pool_free(&reservation_pool, res);
+}
+
+// Mencari reservasi pertama milik user dengan waktu dan dokter tertentu
+// (lower bound di AVL pasien, O(log n))
+ReservationNode *find_reservation(User *u, int when, int doctor_id)
+{
+    ReservationNode *found = NULL;
+    for (AVLNode *node = u->reservations; node;)
+    {
+        ReservationNode *res = node->res;
+        int cmp = (res->when > when) - (res->when < when);
+        if (cmp == 0)
+            cmp = (res->doctor_id > doctor_id) - (res->doctor_id < doctor_id);
+
+        if (cmp < 0)
+        {
+            node = node->right;
+        }
+        else
+        {
+            if (cmp == 0)
+                found = res;
+            node = node->left;
+        }
+    }
+    return found;
+}
+
+// Lihat [RESERVATION ARCHIVE]
+void archive_purge_user(const char *username);
+
+// Menghapus user dari hash table beserta semua reservasinya
+// Return 0 jika user tidak ditemukan
+int remove_user(hash_table *ht, const char *username)
+{
+    unsigned int hash = hash_function(username);
+    int slot = find_user_slot(ht, username, hash);
+    if (slot < 0 && snapshot_find_user(ht, username, hash))
+        slot = find_user_slot(ht, username, hash);
+    if (slot < 0)
+        return 0;
+    archive_purge_user(username); // baris di segment arsip tidak dimuat
+
+    User *cur = ht->slots[slot].user;
+    if (snapshot.user_state && cur->id < snapshot.header->user_count)
+        snapshot.user_state[cur->id] = SNAPSHOT_USER_DELETED;
+    user_index.by_id[cur->id] = NULL;
+
+    // Backward shift deletion: geser entry berikutnya mundur satu slot
+    // sampai ketemu slot kosong atau entry yang sudah di posisi idealnya
+    int mask = ht->capacity - 1;
+    int next = (slot + 1) & mask;
+    while (ht->slots[next].user && probe_distance(ht, ht->slots[next].hash, next) > 0)
+    {
+        ht->slots[slot] = ht->slots[next];
+        slot = next;
+        next = (next + 1) & mask;
+    }
+    ht->slots[slot].user = NULL;
+    ht->slots[slot].hash = 0;
+    ht->count--;
+    if (cur->role == ROLE_DOCTOR && trie_root)
+        remove_trie(trie_root, cur);
+
+    // Free all reservations
+    AVLCursor cursor;
+    avl_cursor_seek(&cursor, cur->reservations, INT_MIN);
+    for (ReservationNode *res; (res = avl_cursor_peek(&cursor)); avl_cursor_next(&cursor))
+    {
+        doctor_schedule_remove(res);
+        store_remove(res);
+        pool_free(&reservation_pool, res);
+    }
+    free_avl(cur->reservations);
+    if (cur->rating_days)
+        pool_free(&rating_days_pool, cur->rating_days);
+    pool_free(&user_pool, cur);
+    return 1;
+}
+
+// ======================= [RATING STATS] =======================
+// Selain agregat all-time, setiap dokter punya ring bucket harian
+// (RATING_BUCKET_DAYS hari terakhir) untuk statistik jendela waktu dan
+// rata-rata ber-decay. Semua diakses di bawah user_lock(doctor)
+
+// Bucket untuk hari day, dibuat (atau menimpa hari lama di posisi ring
+// yang sama) bila perlu. NULL jika day lebih tua dari isi ring saat ini
+static RatingBucket *rating_bucket(User *doctor, int day)
+{
+    if (day < 0)
+        return NULL;
+    if (!doctor->rating_days)
+    {
+        doctor->rating_days = (RatingDays *)pool_alloc(&rating_days_pool);
+        if (!doctor->rating_days)
+            return NULL;
+        for (int i = 0; i < RATING_BUCKET_DAYS; i++)
+            doctor->rating_days->bucket[i].day = -1;
+    }
+
+    RatingBucket *b = &doctor->rating_days->bucket[day % RATING_BUCKET_DAYS];
+    if (b->day == day)
+        return b;
+    if (b->day > day)
+        return NULL;
+    b->day = day;
+    memset(b->hist, 0, sizeof(b->hist));
+    return b;
+}
+
+// Rating 1..5 sudah divalidasi pemanggil. when = -1 untuk rating tanpa
+// waktu (log format lama): hanya masuk agregat all-time
+void apply_rating(User *doctor, int rating, int when)
+{
+    doctor->total_rating += rating;
+    doctor->rating_count++;
+    doctor->rating_hist[rating - 1]++;
+
+    RatingBucket *b = when >= 0 ? rating_bucket(doctor, when / MINUTES_PER_DAY) : NULL;
+    if (b)
+        b->hist[rating - 1]++;
+}
+
+// Statistik rating `days` hari terakhir sampai today (inklusif). O(days)
+void rating_window(const User *doctor, int today, int days, RatingWindow *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->average = -1.0f;
+    if (!doctor->rating_days)
+        return;
+    if (days > RATING_BUCKET_DAYS)
+        days = RATING_BUCKET_DAYS;
+
+    long long sum = 0;
+    for (int day = today - days + 1; day <= today; day++)
+    {
+        const RatingBucket *b = &doctor->rating_days->bucket[day % RATING_BUCKET_DAYS];
+        if (day < 0 || b->day != day)
+            continue;
+        for (int r = 0; r < 5; r++)
+        {
+            out->hist[r] += b->hist[r];
+            out->count += b->hist[r];
+            sum += (long long)b->hist[r] * (r + 1);
+        }
+    }
+    if (out->count)
+        out->average = (float)sum / out->count;
+}
+
+// Rating terkecil r sehingga minimal pct% rating di jendela <= r (0 = kosong)
+int rating_percentile(const RatingWindow *w, int pct)
+{
+    if (!w->count)
+        return 0;
+    long long need = ((long long)w->count * pct + 99) / 100;
+    if (need < 1)
+        need = 1;
+    long long seen = 0;
+    for (int r = 0; r < 5; r++)
+    {
+        seen += w->hist[r];
+        if (seen >= need)
+            return r + 1;
+    }
+    return 5;
+}
+
+// Rata-rata seluruh ring dengan bobot 2^(-umur / half-life), umur dalam
+// hari dari today. *weight = jumlah bobot (jumlah rating "efektif").
+// Bobot rating di luar ring sudah < 2^(-90/14), jadi diabaikan
+float rating_decayed(const User *doctor, int today, float *weight)
+{
+    double sum = 0, total_weight = 0;
+    if (doctor->rating_days)
+    {
+        for (int i = 0; i < RATING_BUCKET_DAYS; i++)
+        {
+            const RatingBucket *b = &doctor->rating_days->bucket[i];
+            if (b->day < 0 || b->day > today || b->day <= today - RATING_BUCKET_DAYS)
+                continue;
+            double w = exp2(-(today - b->day) / RATING_HALF_LIFE_DAYS);
+            for (int r = 0; r < 5; r++)
+            {
+                sum += w * b->hist[r] * (r + 1);
+                total_weight += w * b->hist[r];
+            }
+        }
+    }
+    if (weight)
+        *weight = (float)total_weight;
+    return total_weight > 0 ? (float)(sum / total_weight) : -1.0f;
+}
+
+// ======================= [BINARY SNAPSHOT] =======================
+// clinic.snap menyimpan seluruh state (user, reservasi, jadwal, rating)
+// dalam format SnapshotHeader. Startup cukup mmap + cek header, lalu
+// hanya dokter yang dibuat sebagai objek; user lain beserta reservasinya
+// dibuat saat pertama dicari, jadwal dokter saat pertama dibaca. File
+// ditulis ulang setiap compaction, dan setelah startup lewat CSV.
+// Materialize berjalan di bawah snapshot.lock; jalur interaktif & batch
+// hanya punya satu thread operasi, server melepas snapshot sebelum mulai
+
+static MappedFile snapshot_file;
+
+// Pointer ke section [offset, offset + count * size), NULL jika keluar file
+static const void *snapshot_section(uint64_t offset, int64_t count, size_t size)
+{
+    if (count < 0 || offset % 8 || offset > snapshot_file.size ||
+        (uint64_t)count > (snapshot_file.size - offset) / size)
+        return NULL;
+    return snapshot_file.data + offset;
+}
+
+// Pointer section menunjuk ke file yang di-map; dikosongkan saat file
+// di-unmap supaya tidak ada yang membaca memori yang sudah dilepas
+static void snapshot_clear_sections(void)
+{
+    snapshot.users = NULL;
+    snapshot.reservations = NULL;
+    snapshot.doctors = NULL;
+    snapshot.by_doctor = NULL;
+    snapshot.doctor_users = NULL;
+    snapshot.days = NULL;
+    snapshot.index = NULL;
+}
+
+// Reservasi baris row sebagai node di memori, dibuat saat pertama diminta
+// (oleh pasien atau jadwal dokternya, mana yang lebih dulu)
+static ReservationNode *snapshot_node(int row)
+{
+    ReservationNode *res = snapshot.nodes[row];
+    if (res)
+        return res == SNAPSHOT_ROW_GONE ? NULL : res;
+
+    const SnapshotReservation *rec = &snapshot.reservations[row];
+    if ((unsigned)rec->doctor_id >= (unsigned)snapshot.header->doctor_count ||
+        (unsigned)rec->patient >= (unsigned)snapshot.header->user_count ||
+        rec->when < archive.cutoff || // sudah dipindah ke arsip (crash sebelum compaction selesai)
+        !memchr(snapshot.users[rec->patient].username, '\0', sizeof(snapshot.users[rec->patient].username)))
+        return NULL;
+    if (!(res = (ReservationNode *)pool_alloc(&reservation_pool)))
+        return NULL;
+    res->when = rec->when;
+    res->doctor_id = rec->doctor_id;
+    res->patient_id = rec->patient;
+    memcpy(res->notes, rec->notes, sizeof(res->notes));
+    res->notes[sizeof(res->notes) - 1] = '\0';
+    res->store_row = -1;
+    res->snapshot_row = row;
+    snapshot.nodes[row] = res;
+    return res;
+}
+
+// Membuat User dari record i beserta AVL reservasinya
+static User *snapshot_materialize(hash_table *ht, int i)
+{
+    const SnapshotUser *rec = &snapshot.users[i];
+    char username[sizeof(rec->username)];
+    memcpy(username, rec->username, sizeof(username));
+    username[sizeof(username) - 1] = '\0';
+
+    User *u = add_user_slot(ht, username, rec->hash, i);
+    if (!u)
+        return NULL;
+    snapshot.user_state[i] = SNAPSHOT_USER_LIVE;
+    memcpy(u->password, rec->password, sizeof(u->password));
+    u->password[sizeof(u->password) - 1] = '\0';
+    u->role = rec->role;
+    u->available = rec->role == ROLE_DOCTOR;
+    u->total_rating = rec->total_rating;
+    u->rating_count = rec->rating_count;
+    memcpy(u->rating_hist, rec->rating_hist, sizeof(u->rating_hist));
+    if ((unsigned)rec->days < (unsigned)snapshot.header->days_count &&
+        (u->rating_days = (RatingDays *)pool_alloc(&rating_days_pool)))
+        memcpy(u->rating_days, &snapshot.days[rec->days], sizeof(RatingDays));
+    if (u->role == ROLE_DOCTOR)
+        insert_trie(trie_root, u);
+
+    int first = rec->first_reservation, count = rec->reservation_count;
+    if (first < 0 || count < 0 || first > snapshot.header->reservation_count - count)
+        count = 0;
+    for (int row = first; row < first + count; row++)
+    {
+        ReservationNode *res = snapshot_node(row);
+        int inserted;
+        if (res)
+            u->reservations = insert_avl(u->reservations, res, AVL_ALLOW_DUPLICATES, &inserted);
+    }
+    AVL_CHECK(u->reservations);
+    return u;
+}
+
+User *snapshot_find_user(hash_table *ht, const char *username, unsigned int hash)
+{
+    if (!__atomic_load_n(&snapshot.header, __ATOMIC_ACQUIRE))
+        return NULL; // jalur cepat tanpa lock: tidak ada snapshot aktif
+
+    User *u = NULL;
+    mutex_lock(&snapshot.lock);
+    const SnapshotHeader *h = snapshot.header;
+    uint32_t mask = h ? h->index_capacity - 1 : 0;
+    for (uint32_t idx = hash & mask, probes = 0; h && snapshot.index[idx] && probes <= mask;
+         idx = (idx + 1) & mask, probes++)
+    {
+        uint32_t i = snapshot.index[idx] - 1;
+        const SnapshotUser *rec = &snapshot.users[i];
+        if (i >= (uint32_t)h->user_count || rec->hash != hash ||
+            strncmp(rec->username, username, sizeof(rec->username)) != 0)
+            continue;
+        if (snapshot.user_state[i] == SNAPSHOT_USER_MAPPED)
+            u = snapshot_materialize(ht, (int)i);
+        break; // LIVE sudah ada di tabel, DELETED sudah dihapus
+    }
+    mutex_unlock(&snapshot.lock);
+    return u;
+}
+
+static void snapshot_fill_locked(DoctorSchedule *s)
+{
+    if (!s->snapshot_pending)
+        return;
+    s->snapshot_pending = 0;
+
+    const SnapshotDoctor *d = &snapshot.doctors[s->id];
+    int first = d->first, count = d->count;
+    if (first < 0 || count < 0 || first > snapshot.header->reservation_count - count)
+        return;
+    for (int k = first; k < first + count; k++)
+    {
+        int row = snapshot.by_doctor[k];
+        ReservationNode *res = (unsigned)row < (unsigned)snapshot.header->reservation_count ? snapshot_node(row) : NULL;
+        if (!res || res->doctor_id != s->id)
+            continue;
+        doctor_schedule_add(res);
+        store_add(res);
+    }
+}
+
+// Memasukkan reservasi dari clinic.snap ke jadwal s (sekali saja).
+// Wajib sebelum jadwal dibaca: cek slot, view dokter, laporan
+void snapshot_fill_schedule(DoctorSchedule *s)
+{
+    if (!s || !s->snapshot_pending)
+        return;
+    mutex_lock(&snapshot.lock);
+    if (snapshot.header)
+        snapshot_fill_locked(s);
+    mutex_unlock(&snapshot.lock);
+}
+
+// Semua jadwal, untuk laporan & analitik yang membaca semua dokter
+void snapshot_fill_schedules(void)
+{
+    mutex_lock(&snapshot.lock);
+    for (int i = 0; snapshot.header && i < doctor_index.count; i++)
+        snapshot_fill_locked(doctor_index.by_id[i]);
+    mutex_unlock(&snapshot.lock);
+}
+
+// Semua user & jadwal dari clinic.snap dijadikan objek biasa lalu file
+// di-unmap; setelah ini lookup tidak lagi melihat file. Dipanggil sebelum
+// apa pun yang menelusuri seluruh hash table (compaction, server)
+void snapshot_release(hash_table *ht)
+{
+    mutex_lock(&snapshot.lock);
+    if (snapshot.header)
+    {
+        for (int i = 0; i < snapshot.header->user_count; i++)
+        {
+            if (snapshot.user_state[i] == SNAPSHOT_USER_MAPPED)
+                snapshot_materialize(ht, i);
+        }
+        for (int i = 0; i < doctor_index.count; i++)
+            snapshot_fill_locked(doctor_index.by_id[i]);
+
+        free(snapshot.user_state);
+        free(snapshot.nodes);
+        snapshot.user_state = NULL;
+        snapshot.nodes = NULL;
+        __atomic_store_n(&snapshot.header, (const SnapshotHeader *)NULL, __ATOMIC_RELEASE);
+        snapshot_clear_sections();
+        unmap_file(&snapshot_file);
+    }
+    mutex_unlock(&snapshot.lock);
+}
+
+// Memakai clinic.snap jika ada, layout-nya cocok dan tidak basi: snapshot
+// reservasi & rating tidak berubah dan users.csv hanya bertambah sejak file
+// ditulis. Dokter langsung di-materialize (radix tree & rating butuh semua
+// dokter). Dipanggil sebelum ada user di tabel. Return 0 dengan *reason
+// (NULL = file tidak ada) jika CSV harus dimuat seperti biasa
+int snapshot_open(hash_table *ht, const char **reason)
+{
+    *reason = NULL;
+    if (!map_file(SNAPSHOT_PATH, &snapshot_file))
+        return 0;
+
+    const SnapshotHeader *h = (const SnapshotHeader *)snapshot_file.data;
+    FileStamp reservations_csv = file_stamp("reservations.csv");
+    FileStamp totals_csv = file_stamp(rating_log.snapshot_path);
+    if (snapshot_file.size < sizeof(SnapshotHeader) || memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0)
+        *reason = "not a snapshot file";
+    else if (h->version != SNAPSHOT_VERSION || h->header_size != sizeof(SnapshotHeader))
+        *reason = "different version";
+    else if (h->file_size != snapshot_file.size)
+        *reason = "truncated";
+    else if (memcmp(&h->reservations_csv, &reservations_csv, sizeof(FileStamp)) != 0 ||
+             memcmp(&h->rating_totals_csv, &totals_csv, sizeof(FileStamp)) != 0 ||
+             file_stamp("users.csv").size < h->users_csv_size)
+        *reason = "stale";
+    else if (!(snapshot.users = (const SnapshotUser *)snapshot_section(h->users_offset, h->user_count, sizeof(SnapshotUser))) ||
+             !(snapshot.reservations = (const SnapshotReservation *)snapshot_section(h->reservations_offset, h->reservation_count, sizeof(SnapshotReservation))) ||
+             !(snapshot.doctors = (const SnapshotDoctor *)snapshot_section(h->doctors_offset, h->doctor_count, sizeof(SnapshotDoctor))) ||
+             !(snapshot.by_doctor = (const int32_t *)snapshot_section(h->by_doctor_offset, h->reservation_count, sizeof(int32_t))) ||
+             !(snapshot.doctor_users = (const int32_t *)snapshot_section(h->doctor_users_offset, h->doctor_user_count, sizeof(int32_t))) ||
+             !(snapshot.days = (const RatingDays *)snapshot_section(h->days_offset, h->days_count, sizeof(RatingDays))) ||
+             !(snapshot.index = (const uint32_t *)snapshot_section(h->index_offset, h->index_capacity, sizeof(uint32_t))) ||
+             (h->index_capacity & (h->index_capacity - 1)) || h->index_capacity <= (uint32_t)h->user_count)
+        *reason = "corrupt";
+    else if (!(snapshot.user_state = (unsigned char *)calloc(h->user_count + 1, 1)) ||
+             !(snapshot.nodes = (ReservationNode **)calloc(h->reservation_count + 1, sizeof(ReservationNode *))) ||
+             !reserve_user_index(h->user_count))
+        *reason = "out of memory";
+    if (*reason)
+    {
+        free(snapshot.user_state);
+        free(snapshot.nodes);
+        snapshot.user_state = NULL;
+        snapshot.nodes = NULL;
+        snapshot_clear_sections();
+        unmap_file(&snapshot_file);
+        return 0;
+    }
+
+    snapshot.header = h;
+    reserve_user_table(ht, h->user_count);
+    user_index.count = h->user_count; // id user dari snapshot = index record
+    for (int d = 0; d < h->doctor_count; d++)
+    {
+        char name[sizeof(((DoctorSchedule *)0)->doctor)];
+        memcpy(name, snapshot.doctors[d].name, sizeof(name));
+        name[sizeof(name) - 1] = '\0';
+        DoctorSchedule *s = find_doctor_schedule(name, 1);
+        if (s && s->id == d)
+            s->snapshot_pending = snapshot.doctors[d].count > 0;
+    }
+    for (int j = 0; j < h->doctor_user_count; j++)
+    {
+        int i = snapshot.doctor_users[j];
+        if ((unsigned)i < (unsigned)h->user_count && snapshot.user_state[i] == SNAPSHOT_USER_MAPPED)
+            snapshot_materialize(ht, i);
+    }
+
+    journal.snapshot_seq = journal.seq = h->journal_seq;
+    rating_log.snapshot_seq = h->rating_snapshot_seq;
+    rating_log.seq = h->rating_seq;
+    return 1;
+}
+
+// Akhir section sepanjang bytes: posisi file dimajukan lalu diberi
+// padding nol sampai kelipatan 8 (syarat snapshot_section)
+static void snapshot_section_end(FILE *file, uint64_t bytes, uint64_t *pos)
+{
+    static const char zero[8] = {0};
+    *pos += bytes;
+    if (*pos % 8)
+    {
+        fwrite(zero, 1, 8 - *pos % 8, file);
+        *pos += 8 - *pos % 8;
+    }
+}
+
+// Menulis seluruh state ke clinic.snap (tmp + rename). Snapshot lama
+// dilepas dulu supaya semua user ada di tabel. Pemanggil memegang
+// table_lock exclusive (atau belum ada thread lain)
+void save_snapshot(hash_table *ht)
+{
+    int64_t started = metric_start();
+    snapshot_release(ht);
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.header_size = sizeof(h);
+    h.journal_seq = journal.seq;
+    h.rating_seq = rating_log.seq;
+    h.rating_snapshot_seq = rating_log.snapshot_seq;
+    h.users_csv_size = file_stamp("users.csv").size;
+    h.reservations_csv = file_stamp("reservations.csv");
+    h.rating_totals_csv = file_stamp(rating_log.snapshot_path);
+    h.user_count = ht->count;
+    h.doctor_count = doctor_index.count;
+
+    int by_doctor_count = 0;
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u)
+            continue;
+        h.reservation_count += avl_size(u->reservations);
+        h.doctor_user_count += u->role == ROLE_DOCTOR;
+        h.days_count += u->rating_days != NULL;
+    }
+    for (int d = 0; d < doctor_index.count; d++)
+        by_doctor_count += avl_size(doctor_index.by_id[d]->appointments);
+    if (by_doctor_count != h.reservation_count)
+    {
+        puts("Snapshot skipped: doctor schedules out of sync.");
+        return;
+    }
+    h.index_capacity = 16;
+    while (h.index_capacity < 2 * (uint32_t)h.user_count)
+        h.index_capacity *= 2;
+
+    // Offset section berurutan, masing-masing di-align 8
+#define SNAPSHOT_ALIGN(n) (((n) + 7) & ~(uint64_t)7)
+    h.users_offset = SNAPSHOT_ALIGN(sizeof(h));
+    h.reservations_offset = SNAPSHOT_ALIGN(h.users_offset + (uint64_t)h.user_count * sizeof(SnapshotUser));
+    h.doctors_offset = SNAPSHOT_ALIGN(h.reservations_offset + (uint64_t)h.reservation_count * sizeof(SnapshotReservation));
+    h.by_doctor_offset = SNAPSHOT_ALIGN(h.doctors_offset + (uint64_t)h.doctor_count * sizeof(SnapshotDoctor));
+    h.doctor_users_offset = SNAPSHOT_ALIGN(h.by_doctor_offset + (uint64_t)h.reservation_count * sizeof(int32_t));
+    h.days_offset = SNAPSHOT_ALIGN(h.doctor_users_offset + (uint64_t)h.doctor_user_count * sizeof(int32_t));
+    h.index_offset = SNAPSHOT_ALIGN(h.days_offset + (uint64_t)h.days_count * sizeof(RatingDays));
+    h.file_size = SNAPSHOT_ALIGN(h.index_offset + (uint64_t)h.index_capacity * sizeof(uint32_t));
+#undef SNAPSHOT_ALIGN
+
+    uint32_t *index = (uint32_t *)calloc(h.index_capacity, sizeof(uint32_t));
+    char tmp_path[260];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", SNAPSHOT_PATH);
+    FILE *file = index ? fopen(tmp_path, "wb") : NULL;
+    if (!file)
+    {
+        free(index);
+        puts("Failed to open snapshot for writing.");
+        return;
+    }
+
+    // User ke-n = urutan slot hash table; urutan yang sama dipakai semua section
+    uint64_t pos = 0;
+    fwrite(&h, sizeof(h), 1, file);
+    snapshot_section_end(file, sizeof(h), &pos);
+    int n = 0, first = 0, days = 0;
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u)
+            continue;
+        SnapshotUser rec;
+        memset(&rec, 0, sizeof(rec));
+        memcpy(rec.username, u->username, sizeof(rec.username));
+        memcpy(rec.password, u->password, sizeof(rec.password));
+        rec.hash = ht->slots[i].hash;
+        rec.role = u->role;
+        rec.total_rating = u->total_rating;
+        rec.rating_count = u->rating_count;
+        memcpy(rec.rating_hist, u->rating_hist, sizeof(rec.rating_hist));
+        rec.first_reservation = first;
+        rec.reservation_count = avl_size(u->reservations);
+        rec.days = u->rating_days ? days++ : -1;
+        first += rec.reservation_count;
+        fwrite(&rec, sizeof(rec), 1, file);
+
+        uint32_t idx = rec.hash & (h.index_capacity - 1);
+        while (index[idx])
+            idx = (idx + 1) & (h.index_capacity - 1);
+        index[idx] = (uint32_t)++n;
+    }
+    snapshot_section_end(file, (uint64_t)h.user_count * sizeof(SnapshotUser), &pos);
+
+    // Reservasi per pasien; nomor baris dicatat di node untuk section by_doctor
+    int row = 0;
+    n = 0;
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u)
+            continue;
+        AVLCursor cursor;
+        avl_cursor_seek(&cursor, u->reservations, INT_MIN);
+        for (ReservationNode *res; (res = avl_cursor_peek(&cursor)); avl_cursor_next(&cursor))
+        {
+            SnapshotReservation rec;
+            memset(&rec, 0, sizeof(rec));
+            rec.when = res->when;
+            rec.doctor_id = res->doctor_id;
+            rec.patient = n;
+            memcpy(rec.notes, res->notes, sizeof(rec.notes));
+            fwrite(&rec, sizeof(rec), 1, file);
+            res->snapshot_row = row++;
+        }
+        n++;
+    }
+    snapshot_section_end(file, (uint64_t)h.reservation_count * sizeof(SnapshotReservation), &pos);
+
+    first = 0;
+    for (int d = 0; d < doctor_index.count; d++)
+    {
+        DoctorSchedule *s = doctor_index.by_id[d];
+        SnapshotDoctor rec;
+        memset(&rec, 0, sizeof(rec));
+        memcpy(rec.name, s->doctor, sizeof(s->doctor));
+        rec.first = first;
+        rec.count = avl_size(s->appointments);
+        first += rec.count;
+        fwrite(&rec, sizeof(rec), 1, file);
+    }
+    snapshot_section_end(file, (uint64_t)h.doctor_count * sizeof(SnapshotDoctor), &pos);
+
+    for (int d = 0; d < doctor_index.count; d++)
+    {
+        AVLCursor cursor;
+        avl_cursor_seek(&cursor, doctor_index.by_id[d]->appointments, INT_MIN);
+        for (ReservationNode *res; (res = avl_cursor_peek(&cursor)); avl_cursor_next(&cursor))
+            fwrite(&res->snapshot_row, sizeof(int32_t), 1, file);
+    }
+    snapshot_section_end(file, (uint64_t)h.reservation_count * sizeof(int32_t), &pos);
+
+    n = 0;
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u)
+            continue;
+        if (u->role == ROLE_DOCTOR)
+            fwrite(&n, sizeof(int32_t), 1, file);
+        n++;
+    }
+    snapshot_section_end(file, (uint64_t)h.doctor_user_count * sizeof(int32_t), &pos);
+
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (u && u->rating_days)
+            fwrite(u->rating_days, sizeof(RatingDays), 1, file);
+    }
+    snapshot_section_end(file, (uint64_t)h.days_count * sizeof(RatingDays), &pos);
+    fwrite(index, sizeof(uint32_t), h.index_capacity, file);
+    snapshot_section_end(file, (uint64_t)h.index_capacity * sizeof(uint32_t), &pos);
+    free(index);
+
+    if (ferror(file) || pos != h.file_size || !sync_file(file))
+    {
+        fclose(file);
+        remove(tmp_path);
+        puts("Failed to save snapshot.");
+        return;
+    }
+    fclose(file);
+    if (!replace_file(tmp_path, SNAPSHOT_PATH))
+        puts("Failed to save snapshot.");
+    metric_stop(METRIC_SAVE_SNAPSHOT, started);
+}
+
+// ======================= [CSV TOKENIZER] =======================
+// Tokenizer bersama untuk semua file CSV & journal. Field dikembalikan
+// sebagai view ke buffer input (tanpa copy). Field boleh di-quote
+// ("a, b" dan "" untuk satu kutip), tapi tidak boleh berisi newline:
+// notes dibersihkan dari newline sebelum ditulis. Delimiter dicari per
+// 32/16 byte dengan AVX2/SSE2 jika tersedia saat compile
+
+typedef struct
+{
+    const char *ptr;
+    int len;
+    int escaped; // field ber-quote yang berisi "" (perlu di-unescape saat copy)
+} CsvField;
+
+#define CSV_MAX_FIELDS 8
+
+// Posisi ',' '"' atau '\n' pertama di [p, end), atau end
+static const char *csv_find_delim_scalar(const char *p, const char *end)
+{
+    while (p < end && *p != ',' && *p != '"' && *p != '\n')
+        p++;
+    return p;
+}
+
+static const char *csv_find_delim_simd(const char *p, const char *end)
+{
+#if defined(__AVX2__)
+    const __m256i comma32 = _mm256_set1_epi8(','), quote32 = _mm256_set1_epi8('"'), nl32 = _mm256_set1_epi8('\n');
+    while (end - p >= 32)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, comma32), _mm256_cmpeq_epi8(v, quote32)),
+                                      _mm256_cmpeq_epi8(v, nl32));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(hit);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#endif
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    const __m128i comma = _mm_set1_epi8(','), quote = _mm_set1_epi8('"'), nl = _mm_set1_epi8('\n');
+    while (end - p >= 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, comma), _mm_cmpeq_epi8(v, quote)),
+                                   _mm_cmpeq_epi8(v, nl));
+        unsigned mask = (unsigned)_mm_movemask_epi8(hit);
+        if (mask)
+            return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    return csv_find_delim_scalar(p, end);
+}
+
+// Bisa diganti ke versi scalar (lihat --bench-csv)
+static const char *(*csv_find_delim)(const char *, const char *) = csv_find_delim_simd;
+
+// Field berikutnya di [*p, eol) dan maju melewati koma sesudahnya.
+// Return 0 jika baris sudah habis atau quote tidak valid
+static int csv_next_field(const char **p, const char *eol, CsvField *f)
+{
+    const char *s = *p;
+    if (s >= eol)
+        return 0;
+
+    if (*s == '"')
+    {
+        const char *q = s + 1;
+        f->escaped = 0;
+        for (;;)
+        {
+            q = (const char *)memchr(q, '"', eol - q);
+            if (!q)
+                return 0; // quote tidak ditutup
+            if (q + 1 < eol && q[1] == '"')
+            {
+                q += 2;
+                f->escaped = 1;
+                continue;
+            }
+            break;
+        }
+        f->ptr = s + 1;
+        f->len = (int)(q - s - 1);
+        s = q + 1;
+        if (s < eol && *s != ',')
+            return 0; // sampah setelah quote penutup
+        *p = s < eol ? s + 1 : eol;
+        return 1;
+    }
+
+    // Field tanpa quote: '"' di tengah field dianggap karakter biasa
+    const char *d = csv_find_delim(s, eol);
+    while (d < eol && *d == '"')
+        d = csv_find_delim(d + 1, eol);
+    f->ptr = s;
+    f->len = (int)(d - s);
+    f->escaped = 0;
+    *p = d < eol ? d + 1 : eol;
+    return 1;
+}
+
+// Memecah satu baris menjadi maksimal max field. Field terakhir (ke-max)
+// mengambil sisa baris jika tidak di-quote, supaya notes lama yang
+// berisi koma tanpa quote tetap terbaca utuh. Return jumlah field
+static int csv_split(const char *p, const char *eol, CsvField *fields, int max)
+{
+    int n = 0;
+    while (n < max && p < eol)
+    {
+        if (n == max - 1 && *p != '"')
+        {
+            fields[n].ptr = p;
+            fields[n].len = (int)(eol - p);
+            fields[n].escaped = 0;
+            return n + 1;
+        }
+        if (!csv_next_field(&p, eol, &fields[n]))
+            return n;
+        n++;
+    }
+    return n;
+}
+
+// Salinan field ke buf (dengan unescape ""). Return 0 jika kosong atau
+// tidak muat: field kunci yang terpotong bisa menunjuk user lain
+static int csv_copy(const CsvField *f, char *buf, int cap)
+{
+    int n = 0;
+    for (int i = 0; i < f->len; i++)
+    {
+        if (n == cap - 1)
+            return 0;
+        buf[n++] = f->ptr[i];
+        if (f->escaped && f->ptr[i] == '"')
+            i++;
+    }
+    buf[n] = '\0';
+    return n > 0;
+}
+
+// Untuk teks bebas (notes): dipotong jika terlalu panjang
+static void csv_copy_text(const CsvField *f, char *buf, int cap)
+{
+    int n = 0;
+    for (int i = 0; i < f->len && n < cap - 1; i++)
+    {
+        buf[n++] = f->ptr[i];
+        if (f->escaped && f->ptr[i] == '"')
+            i++;
+    }
+    buf[n] = '\0';
+}
+
+static int csv_long(const CsvField *f, long long *out)
+{
+    const char *s = f->ptr, *end = f->ptr + f->len;
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    int sign = 1;
+    if (s < end && (*s == '-' || *s == '+'))
+        sign = (*s++ == '-') ? -1 : 1;
+    if (s >= end || *s < '0' || *s > '9')
+        return 0;
+
+    long long value = 0;
+    while (s < end && *s >= '0' && *s <= '9')
+        value = value * 10 + (*s++ - '0');
+    while (s < end && (*s == ' ' || *s == '\t'))
+        s++;
+    *out = sign * value;
+    return s == end;
+}
+
+static int csv_int(const CsvField *f, int *out)
+{
+    long long value;
+    if (!csv_long(f, &value) || value < INT_MIN || value > INT_MAX)
+        return 0;
+    *out = (int)value;
+    return 1;
+}
+
+// Menulis teks sebagai field CSV: di-quote hanya jika berisi koma atau kutip
+const char *csv_quote(const char *text, char *buf, size_t cap)
+{
+    if (!strpbrk(text, ",\""))
+        return text;
+    size_t n = 0;
+    buf[n++] = '"';
+    for (const char *c = text; *c && n + 3 < cap; c++)
+    {
+        if (*c == '"')
+            buf[n++] = '"';
+        buf[n++] = *c;
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+    return buf;
+}
+
+// ======================= [PERSISTENCE] =======================
+
+// Menulis semua user ke file baru lalu mengganti filename.
+// Return 0 jika gagal (file lama tetap utuh)
+int save_users_to_csv(hash_table *ht, const char *filename)
+{
+    int64_t started = metric_start();
+    char tmp_path[260];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filename);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file)
+    {
+        puts("Failed to open user CSV for writing.");
+        return 0;
+    }
+
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (u)
+            fprintf(file, "%s,%s,%d\n", u->username, u->password, u->role);
+    }
+
+    if (!sync_file(file))
+    {
+        fclose(file);
+        remove(tmp_path);
+        puts("Failed to save users.");
+        return 0;
+    }
+    fclose(file);
+    if (!replace_file(tmp_path, filename))
+    {
+        remove(tmp_path);
+        puts("Failed to save users.");
+        return 0;
+    }
+    metric_stop(METRIC_SAVE_USERS, started);
+    return 1;
+}
+
+// Menulis snapshot semua reservasi.
+// Baris kedua mencatat nomor event journal terakhir yang sudah termasuk
+// di snapshot ini, supaya replay tidak menerapkan event yang sama dua kali.
+// Return 0 jika gagal (file lama tetap utuh)
+int save_reservations_to_csv(hash_table *ht, const char *filename, long long journal_seq)
+{
+    int64_t started = metric_start();
+    char tmp_path[260];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filename);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file)
+    {
+        puts("Failed to open file to save reservations.");
+        return 0;
+    }
+
+    fprintf(file, "username,date,time,doctor,notes\n"); // CSV header
+    fprintf(file, "#journal_seq,%lld\n", journal_seq);
+
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u)
+            continue;
+
+        AVLCursor cursor;
+        avl_cursor_seek(&cursor, u->reservations, INT_MIN);
+        for (ReservationNode *res; (res = avl_cursor_peek(&cursor)); avl_cursor_next(&cursor))
+        {
+            char date[11], time[6];
+            format_when(res->when, date, time);
+            char quoted[2 * sizeof(res->notes) + 2];
+            fprintf(file, "%s,%s,%s,%s,%s\n",
+                    u->username,
+                    date,
+                    time,
+                    doctor_name(res->doctor_id),
+                    csv_quote(res->notes, quoted, sizeof(quoted)));
+        }
+    }
+
+    if (!sync_file(file))
+    {
+        fclose(file);
+        remove(tmp_path);
+        puts("Failed to save reservations.");
+        return 0;
+    }
+    fclose(file);
+    if (!replace_file(tmp_path, filename))
+    {
+        remove(tmp_path);
+        puts("Failed to save reservations.");
+        return 0;
+    }
+    metric_stop(METRIC_SAVE_RESERVATIONS, started);
+    return 1;
+}
+
+// Membuka journal untuk append setelah snapshot + journal selesai di-replay
+static void journal_open(const char *snapshot_path, const char *path)
+{
+    journal.snapshot_path = snapshot_path;
+    journal.path = path;
+    journal.file = fopen(path, "a");
+    journal.last_sync = time(NULL);
+    if (!journal.file)
+        puts("Failed to open reservation journal.");
+}
+
+void journal_sync(void)
+{
+    if (journal.file && journal.unsynced > 0)
+    {
+        sync_file(journal.file);
+        journal.unsynced = 0;
+        journal.last_sync = time(NULL);
+    }
+}
+
+// Semua penulisan file (journal, append users.csv & ratings.csv) dilakukan
+// satu thread persistence. Producer (thread mana pun) memasukkan baris
+// yang sudah diformat ke ring MPSC lock-free: slot diklaim dengan CAS pada
+// head, lalu seq slot menandai kapan isinya siap dibaca / boleh dipakai
+// ulang. Consumer menulis semua baris yang tersedia sekaligus, baru flush.
+
+#define PERSIST_JOURNAL 0
+#define PERSIST_USERS 1
+#define PERSIST_RATINGS 2
+
+typedef struct
+{
+    size_t seq; // == posisi + 1: terisi; == posisi: kosong (atomik)
+    int target; // PERSIST_*
+    char line[320]; // cukup untuk event C dengan notes 99 karakter yang di-quote
+} PersistSlot;
+
+typedef struct
+{
+    PersistSlot *slots;
+    size_t head; // klaim berikutnya, dibagi semua producer (atomik)
+    char pad[64]; // head dan tail di cache line berbeda
+    size_t tail;  // baca berikutnya, hanya consumer
+    int running;
+    int stop; // atomik
+    thread_t thread;
+    hash_table *ht;
+    FILE *users_file; // dibuka saat pertama dipakai
+    FILE *ratings_file;
+    long long written[3]; // baris per PERSIST_*
+    long long batches;
+} PersistQueue;
+
+PersistQueue persist;
+
+static FILE *persist_open(FILE **file, const char *path)
+{
+    if (!*file && !(*file = fopen(path, "a")))
+        fprintf(stderr, "Failed to open %s for writing.\n", path);
+    return *file;
+}
+
+static void persist_write(int target, const char *line)
+{
+    FILE *file = target == PERSIST_JOURNAL ? journal.file
+                 : target == PERSIST_USERS ? persist_open(&persist.users_file, "users.csv")
+                                           : persist_open(&persist.ratings_file, rating_log.path);
+    if (!file)
+        return;
+    fputs(line, file);
+    fputc('\n', file);
+    persist.written[target]++;
+    if (target == PERSIST_JOURNAL)
+    {
+        journal.unsynced++;
+        journal.since_snapshot++;
+    }
+    else if (target == PERSIST_RATINGS)
+    {
+        rating_log.since_snapshot++;
+    }
+}
+
+// fflush setiap batch (aman dari crash proses), fsync journal dikelompokkan
+// per JOURNAL_SYNC_BATCH event atau JOURNAL_SYNC_INTERVAL detik
+static void persist_flush(void)
+{
+    if (journal.file)
+        fflush(journal.file);
+    if (persist.users_file)
+        fflush(persist.users_file);
+    if (persist.ratings_file)
+        fflush(persist.ratings_file);
+    if (journal.unsynced >= JOURNAL_SYNC_BATCH ||
+        (journal.unsynced > 0 && time(NULL) - journal.last_sync >= JOURNAL_SYNC_INTERVAL))
+        journal_sync();
+}
+
+static void persist_push(int target, const char *fmt, va_list args)
+{
+    if (!persist.running)
+    {
+        // Belum/tidak ada thread persistence: tulis langsung
+        char line[sizeof(((PersistSlot *)0)->line)];
+        vsnprintf(line, sizeof(line), fmt, args);
+        persist_write(target, line);
+        persist_flush();
+        return;
+    }
+
+    size_t pos = __atomic_load_n(&persist.head, __ATOMIC_RELAXED);
+    PersistSlot *slot;
+    for (;;)
+    {
+        slot = &persist.slots[pos & (PERSIST_RING_SIZE - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0)
+        {
+            if (__atomic_compare_exchange_n(&persist.head, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        }
+        else if (diff < 0)
+        {
+            sleep_ms(1); // ring penuh: tunggu consumer
+            pos = __atomic_load_n(&persist.head, __ATOMIC_RELAXED);
+        }
+        else
+        {
+            pos = __atomic_load_n(&persist.head, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->target = target;
+    vsnprintf(slot->line, sizeof(slot->line), fmt, args);
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void persist_line(int target, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    persist_push(target, fmt, args);
+    va_end(args);
+}
+
+// Menulis semua slot yang sudah siap. Return jumlah baris
+static int persist_drain(void)
+{
+    int count = 0;
+    for (;;)
+    {
+        PersistSlot *slot = &persist.slots[persist.tail & (PERSIST_RING_SIZE - 1)];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != persist.tail + 1)
+            break;
+        persist_write(slot->target, slot->line);
+        __atomic_store_n(&slot->seq, persist.tail + PERSIST_RING_SIZE, __ATOMIC_RELEASE);
+        persist.tail++;
+        count++;
+    }
+    return count;
+}
+
+// Lihat [RESERVATION ARCHIVE]
+int archive_due(void);
+void archive_close_months(void);
+
+// Compaction: pindahkan bulan yang sudah lewat ke arsip, tulis snapshot
+// baru (users + reservasi, lalu clinic.snap) kemudian kosongkan journal.
+// Jika crash sebelum journal dikosongkan, #journal_seq di snapshot
+// membuat event lama di-skip saat replay.
+// Pemanggil memegang table_lock exclusive dan ring sudah kosong
+void compact_journal(hash_table *ht)
+{
+    if (!journal.file)
+        return;
+
+    int64_t started = metric_start();
+    journal_sync();
+    if (persist.users_file) // users.csv akan diganti file baru
+    {
+        fclose(persist.users_file);
+        persist.users_file = NULL;
+    }
+    snapshot_release(ht);
+    archive_close_months();
+    // Reservasi (dengan #journal_seq baru) hanya ditulis jika users.csv
+    // baru berhasil: users.csv lama + seq baru akan melewati event hapus user
+    if (!save_users_to_csv(ht, "users.csv") ||
+        !save_reservations_to_csv(ht, journal.snapshot_path, journal.seq))
+    {
+        // Journal tetap satu-satunya salinan event sejak snapshot lama:
+        // tidak dikosongkan, compaction dicoba lagi setelah threshold berikutnya
+        journal.since_snapshot = 0;
+        metric_stop(METRIC_COMPACT_JOURNAL, started);
+        return;
+    }
+    save_snapshot(ht);
+
+    fclose(journal.file);
+    journal.file = fopen(journal.path, "w");
+    journal.since_snapshot = 0;
+    if (!journal.file)
+        puts("Failed to reopen reservation journal.");
+    metric_stop(METRIC_COMPACT_JOURNAL, started);
+}
+
+// Return 0 jika gagal (file lama tetap utuh)
+int save_rating_totals(hash_table *ht, const char *filename, long long rating_seq)
+{
+    char tmp_path[260];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", filename);
+
+    FILE *file = fopen(tmp_path, "w");
+    if (!file)
+    {
+        puts("Failed to open rating snapshot for writing.");
+        return 0;
+    }
+
+    fprintf(file, "doctor,total,count,r1,r2,r3,r4,r5\n");
+    fprintf(file, "#rating_seq,%lld\n", rating_seq);
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *u = ht->slots[i].user;
+        if (!u || u->role != ROLE_DOCTOR || u->rating_count == 0)
+            continue;
+        fprintf(file, "%s,%d,%d,%d,%d,%d,%d,%d\n", u->username, u->total_rating, u->rating_count,
+                u->rating_hist[0], u->rating_hist[1], u->rating_hist[2], u->rating_hist[3], u->rating_hist[4]);
+
+        // Bucket harian: doctor,YYYY-MM-DD,r1..r5
+        for (int b = 0; u->rating_days && b < RATING_BUCKET_DAYS; b++)
+        {
+            const RatingBucket *bucket = &u->rating_days->bucket[b];
+            if (bucket->day < 0)
+                continue;
+            char date[11], time[6];
+            format_when(bucket->day * MINUTES_PER_DAY, date, time);
+            fprintf(file, "%s,%s,%d,%d,%d,%d,%d\n", u->username, date, bucket->hist[0], bucket->hist[1],
+                    bucket->hist[2], bucket->hist[3], bucket->hist[4]);
+        }
+    }
+
+    if (!sync_file(file))
+    {
+        fclose(file);
+        remove(tmp_path);
+        puts("Failed to save rating snapshot.");
+        return 0;
+    }
+    fclose(file);
+    if (!replace_file(tmp_path, filename))
+    {
+        remove(tmp_path);
+        puts("Failed to save rating snapshot.");
+        return 0;
+    }
+    return 1;
+}
+
+// Tulis agregat rating lalu kosongkan ratings.csv. Jika crash di antaranya,
+// baris log dengan seq <= #rating_seq di-skip saat startup.
+// Pemanggil memegang table_lock exclusive (atau belum ada thread lain)
+void compact_ratings(hash_table *ht)
+{
+    int64_t started = metric_start();
+    if (persist.ratings_file)
+    {
+        fclose(persist.ratings_file);
+        persist.ratings_file = NULL;
+    }
+    if (!save_rating_totals(ht, rating_log.snapshot_path, rating_log.seq))
+    {
+        // Agregat lama + log utuh masih konsisten; dicoba lagi nanti
+        rating_log.since_snapshot = 0;
+        metric_stop(METRIC_COMPACT_RATINGS, started);
+        return;
+    }
+
+    FILE *file = fopen(rating_log.path, "w");
+    if (file)
+        fclose(file);
+    else
+        puts("Failed to truncate rating log.");
+    rating_log.snapshot_seq = rating_log.seq;
+    rating_log.since_snapshot = 0;
+    save_snapshot(ht); // stamp rating_totals.csv berubah
+    metric_stop(METRIC_COMPACT_RATINGS, started);
+}
+
+// Compaction butuh snapshot yang konsisten, jadi menunggu table_lock
+// exclusive. Hanya try-lock: producer bisa sedang menunggu ring kosong
+// sambil memegang table_lock shared. Gagal = dicoba lagi di batch berikut
+static void persist_try_compact(void)
+{
+    int journal_due = journal.since_snapshot >= JOURNAL_COMPACT_THRESHOLD || archive_due();
+    int ratings_due = rating_log.since_snapshot >= RATING_COMPACT_THRESHOLD;
+    if ((!journal_due && !ratings_due) || !rwlock_try_write_lock(&table_lock))
+        return;
+    persist_drain(); // tidak ada producer aktif, ring jadi kosong
+    persist_flush();
+    snapshot_release(persist.ht);
+    if (journal_due)
+        compact_journal(persist.ht);
+    if (ratings_due)
+        compact_ratings(persist.ht);
+    rwlock_write_unlock(&table_lock);
+}
+
+static void *persist_thread(void *arg)
+{
+    (void)arg;
+    time_t metrics_written = time(NULL);
+    for (;;)
+    {
+        time_t now = time(NULL);
+        if (now - metrics_written >= METRICS_INTERVAL_SECONDS)
+        {
+            write_metrics_file(METRICS_PATH);
+            metrics_written = now;
+        }
+        int stop = __atomic_load_n(&persist.stop, __ATOMIC_ACQUIRE);
+        if (persist_drain() > 0)
+        {
+            persist.batches++;
+            persist_flush();
+            persist_try_compact();
+        }
+        else if (stop)
+        {
+            break; // stop dibaca sebelum drain terakhir, jadi ring sudah kosong
+        }
+        else
+        {
+            if (journal.unsynced > 0)
+                persist_flush(); // fsync yang tertunda karena interval
+            sleep_ms(PERSIST_IDLE_MS);
+        }
+    }
+    return NULL;
+}
+
+// Dipanggil setelah data selesai dimuat
+void persistence_start(hash_table *ht)
+{
+    persist.ht = ht;
+    persist.slots = (PersistSlot *)malloc(PERSIST_RING_SIZE * sizeof(PersistSlot));
+    if (!persist.slots)
+        return; // tetap jalan dengan penulisan langsung
+    for (size_t i = 0; i < PERSIST_RING_SIZE; i++)
+        persist.slots[i].seq = i;
+    persist.head = persist.tail = 0;
+    persist.stop = 0;
+    persist.running = thread_start(&persist.thread, persist_thread, NULL);
+}
+
+// Menunggu semua mutasi tertulis lalu menutup file. Tidak boleh ada
+// producer yang masih berjalan
+void persistence_stop(void)
+{
+    if (persist.running)
+    {
+        __atomic_store_n(&persist.stop, 1, __ATOMIC_RELEASE);
+        thread_join(persist.thread);
+        persist.running = 0;
+    }
+    persist_flush();
+    journal_sync();
+    write_metrics_file(METRICS_PATH);
+    if (journal.file)
+        fclose(journal.file);
+    if (persist.users_file)
+        fclose(persist.users_file);
+    if (persist.ratings_file)
+        fclose(persist.ratings_file);
+    journal.file = persist.users_file = persist.ratings_file = NULL;
+}
+
+// Menambahkan satu event ke journal: "<seq>,<event>". Nomor urut diambil
+// di sini, di bawah lock user/dokter pemanggil, sehingga urutan event
+// untuk user & dokter yang sama di file tetap sesuai urutan di memori
+void journal_append(const char *fmt, ...)
+{
+    char event[sizeof(((PersistSlot *)0)->line)];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(event, sizeof(event), fmt, args);
+    va_end(args);
+
+    long long seq = __atomic_add_fetch(&journal.seq, 1, __ATOMIC_RELAXED);
+    persist_line(PERSIST_JOURNAL, "%lld,%s", seq, event);
+}
+
+// Append satu user baru ke users.csv (lewat thread persistence)
+void save_user_to_csv(const char *username, const char *password, int role)
+{
+    persist_line(PERSIST_USERS, "%s,%s,%d", username, password, role);
+}
+
+// Append satu rating ke log. Seq hanya untuk membedakan baris yang sudah
+// masuk snapshot; urutan antar rating tidak penting karena agregatnya jumlah
+void save_rating_to_csv(const char *doctor_name, int rating, int when)
+{
+    long long seq = __atomic_add_fetch(&rating_log.seq, 1, __ATOMIC_RELAXED);
+    persist_line(PERSIST_RATINGS, "%lld,%s,%d,%d", seq, doctor_name, rating, when);
+}
+
+// Menerapkan ulang event journal yang lebih baru dari snapshot
+static void replay_journal(hash_table *ht, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return;
+
+    char line[400];
+    while (fgets(line, sizeof(line), file))
+    {
+        CsvField f[7];
+        const char *eol = line + strcspn(line, "\r\n");
+        int n = csv_split(line, eol, f, 7);
+        long long seq;
+        if (n < 3 || !csv_long(&f[0], &seq) || f[1].len != 1)
+            continue;
+        if (seq > journal.seq)
+            journal.seq = seq;
+        if (seq <= journal.snapshot_seq)
+            continue;
+        journal.since_snapshot++;
+
+        char type = f[1].ptr[0];
+        char username[20], date[20], time[10], doctor[50];
+        if (!csv_copy(&f[2], username, sizeof(username)))
+            continue;
+        if (type == 'C' && n == 7 && csv_copy(&f[3], date, sizeof(date)) &&
+            csv_copy(&f[4], time, sizeof(time)) && csv_copy(&f[5], doctor, sizeof(doctor)))
+        {
+            User *u = find_user(ht, username);
+            int when, doctor_id;
+            // Bulan yang sudah diarsipkan: event-nya sudah tercakup di segment
+            if (!u || !make_when(date, time, &when) || when < archive.cutoff ||
+                (doctor_id = intern_doctor(doctor)) < 0)
+                continue;
+
+            ReservationNode *res = (ReservationNode *)pool_alloc(&reservation_pool);
+            if (!res)
+                continue;
+            res->when = when;
+            res->doctor_id = doctor_id;
+            res->patient_id = u->id;
+            res->snapshot_row = -1;
+            csv_copy_text(&f[6], res->notes, sizeof(res->notes));
+            if (!add_reservation(u, res, AVL_ALLOW_DUPLICATES))
+                pool_free(&reservation_pool, res);
+        }
+        else if (type == 'X' && n == 6 && csv_copy(&f[3], date, sizeof(date)) &&
+                 csv_copy(&f[4], time, sizeof(time)) && csv_copy(&f[5], doctor, sizeof(doctor)))
+        {
+            User *u = find_user(ht, username);
+            DoctorSchedule *schedule = find_doctor_schedule(doctor, 0);
+            int when;
+            ReservationNode *res = NULL;
+            if (u && schedule && make_when(date, time, &when) && when >= archive.cutoff)
+                res = find_reservation(u, when, schedule->id);
+            if (res)
+                remove_reservation(u, res);
+        }
+        else if (type == 'D')
+        {
+            remove_user(ht, username);
+        }
+    }
+
+    fclose(file);
+}
+
+// ======================= [STARTUP LOADER] =======================
+// Semua file CSV di-mmap lalu dipecah menjadi chunk yang batasnya
+// selalu di awal baris. Setiap chunk di-parse oleh thread sendiri ke
+// array baris (hash username sudah dihitung di thread), kemudian hasilnya
+// digabung ke hash table secara berurutan sesuai urutan di file.
+
+typedef struct csv_chunk CsvChunk;
+typedef void (*CsvParseFn)(CsvChunk *chunk);
+
+struct csv_chunk
+{
+    const char *begin;
+    const char *end;
+    int skip_header; // chunk pertama file dengan baris header
+    void *rows;
+    int count;
+    int capacity;
+    long long snapshot_seq; // #journal_seq / #rating_seq di file snapshot
+    int rejected;          // baris dengan field tidak valid / terlalu panjang
+    Pool pool;             // pool lokal thread untuk ReservationNode
+    CsvParseFn parse;
+    thread_t thread;
+    double done_ms;
+};
+
+typedef struct
+{
+    const char *filename;
+    MappedFile file;
+    int found;
+    CsvChunk chunks[LOADER_MAX_CHUNKS];
+    int chunk_count;
+    int rows;
+    int rejected;
+    double start_ms;
+    double parse_ms; // waktu sampai semua chunk selesai di-parse
+    double merge_ms;
+} CsvLoad;
+
+typedef struct
+{
+    unsigned int hash;
+    char username[20];
+    char password[20];
+    int role;
+} UserRow;
+
+typedef struct
+{
+    unsigned int hash; // hash username pasien
+    ReservationNode *res;
+    char patient[20]; // dicari saat merge, lalu res->patient_id diisi id-nya
+    char doctor[50];  // di-intern saat merge (doctor_index tidak thread-safe)
+} ReservationRow;
+
+typedef struct
+{
+    unsigned int hash;
+    char doctor[50];
+    int rating;
+    long long seq; // 0 = baris format lama tanpa seq
+    int when;      // -1 = tanpa waktu
+} RatingRow;
+
+typedef struct
+{
+    unsigned int hash;
+    char doctor[50];
+    int day; // -1 = baris agregat all-time, selain itu bucket harian
+    int total;
+    int count;
+    int hist[5];
+} RatingTotalRow;
+
+// Menambah satu slot baris di chunk (array tumbuh dua kali lipat)
+static void *chunk_push(CsvChunk *chunk, size_t row_size)
+{
+    if (chunk->count == chunk->capacity)
+    {
+        int capacity = chunk->capacity ? chunk->capacity * 2 : 256;
+        void *rows = realloc(chunk->rows, capacity * row_size);
+        if (!rows)
+            return NULL;
+        chunk->rows = rows;
+        chunk->capacity = capacity;
+    }
+    return (char *)chunk->rows + (size_t)chunk->count++ * row_size;
+}
+
+// Baris "#<tag>,<seq>" di snapshot: nomor event terakhir yang sudah tercakup
+static void scan_seq_tag(CsvChunk *chunk, const char *p, const char *eol, const char *tag)
+{
+    size_t len = strlen(tag);
+    CsvField f = {p + len, (int)(eol - p - len), 0};
+    long long seq;
+    if ((size_t)(eol - p) > len && memcmp(p, tag, len) == 0 && csv_long(&f, &seq) &&
+        seq > chunk->snapshot_seq)
+        chunk->snapshot_seq = seq;
+}
+
+// Mengembalikan akhir baris (tanpa '\r') dan memajukan *next ke baris berikut
+static const char *line_end(const char *p, const char *end, const char **next)
+{
+    const char *nl = (const char *)memchr(p, '\n', end - p);
+    const char *eol = nl ? nl : end;
+    *next = nl ? nl + 1 : end;
+    if (eol > p && eol[-1] == '\r')
+        eol--;
+    return eol;
+}
+
+// users.csv: username,password,role
+static void parse_user_chunk(CsvChunk *chunk)
+{
+    const char *p = chunk->begin;
+    while (p < chunk->end)
+    {
+        const char *next;
+        const char *eol = line_end(p, chunk->end, &next);
+        CsvField f[3];
+        UserRow row;
+
+        if (eol == p)
+        {
+            p = next;
+            continue;
+        }
+        if (csv_split(p, eol, f, 3) == 3 &&
+            csv_copy(&f[0], row.username, sizeof(row.username)) &&
+            csv_copy(&f[1], row.password, sizeof(row.password)) &&
+            csv_int(&f[2], &row.role))
+        {
+            to_lowercase(row.username);
+            row.hash = hash_function(row.username);
+            UserRow *slot = (UserRow *)chunk_push(chunk, sizeof(UserRow));
+            if (slot)
+                *slot = row;
+        }
+        else
+        {
+            chunk->rejected++;
+        }
+        p = next;
+    }
+}
+
+// reservations.csv: username,date,time,doctor,notes
+static void parse_reservation_chunk(CsvChunk *chunk)
+{
+    const char *p = chunk->begin;
+    if (chunk->skip_header)
+        line_end(p, chunk->end, &p);
+
+    while (p < chunk->end)
+    {
+        const char *next;
+        const char *eol = line_end(p, chunk->end, &next);
+
+        if (eol == p || *p == '#')
+        {
+            if (eol != p)
+                scan_seq_tag(chunk, p, eol, "#journal_seq,");
+            p = next;
+            continue;
+        }
+
+        ReservationNode *res = (ReservationNode *)pool_alloc(&chunk->pool);
+        if (!res)
+            break;
+
+        CsvField f[5];
+        char patient[20], date[20], time[10], doctor[50];
+        if (csv_split(p, eol, f, 5) == 5 &&
+            csv_copy(&f[0], patient, sizeof(patient)) &&
+            csv_copy(&f[1], date, sizeof(date)) &&
+            csv_copy(&f[2], time, sizeof(time)) &&
+            csv_copy(&f[3], doctor, sizeof(doctor)) &&
+            make_when(date, time, &res->when))
+        {
+            csv_copy_text(&f[4], res->notes, sizeof(res->notes));
+            res->snapshot_row = -1;
+            ReservationRow *row = (ReservationRow *)chunk_push(chunk, sizeof(ReservationRow));
+            if (row)
+            {
+                row->hash = hash_function(patient);
+                row->res = res;
+                strcpy(row->patient, patient);
+                strcpy(row->doctor, doctor);
+                res = NULL;
+            }
+        }
+        else
+        {
+            chunk->rejected++;
+        }
+        pool_free(&chunk->pool, res);
+        p = next;
+    }
+}
+
+// ratings.csv (log sejak snapshot): seq,doctor,rating,when
+// Format lama doctor,rating dan seq,doctor,rating tetap dibaca
+// (seq = 0 / when = -1 untuk kolom yang tidak ada)
+static void parse_rating_chunk(CsvChunk *chunk)
+{
+    const char *p = chunk->begin;
+    while (p < chunk->end)
+    {
+        const char *next;
+        const char *eol = line_end(p, chunk->end, &next);
+        CsvField f[4];
+        RatingRow row;
+        row.seq = 0;
+        row.when = -1;
+
+        if (eol == p)
+        {
+            p = next;
+            continue;
+        }
+        int n = csv_split(p, eol, f, 4);
+        const CsvField *name = n == 2 ? &f[0] : &f[1];
+        if (n >= 2 && (n == 2 || csv_long(&f[0], &row.seq)) &&
+            csv_copy(name, row.doctor, sizeof(row.doctor)) && csv_int(name + 1, &row.rating) &&
+            (n < 4 || csv_int(&f[3], &row.when)) && row.rating >= 1 && row.rating <= 5)
+        {
+            to_lowercase(row.doctor);
+            row.hash = hash_function(row.doctor);
+            RatingRow *slot = (RatingRow *)chunk_push(chunk, sizeof(RatingRow));
+            if (slot)
+                *slot = row;
+        }
+        else
+        {
+            chunk->rejected++;
+        }
+        p = next;
+    }
+}
+
+// rating_totals.csv: doctor,total,count,r1,r2,r3,r4,r5 plus #rating_seq,
+// diikuti bucket harian dokter itu: doctor,YYYY-MM-DD,r1,r2,r3,r4,r5
+static void parse_rating_total_chunk(CsvChunk *chunk)
+{
+    const char *p = chunk->begin;
+    if (chunk->skip_header)
+        line_end(p, chunk->end, &p);
+
+    while (p < chunk->end)
+    {
+        const char *next;
+        const char *eol = line_end(p, chunk->end, &next);
+
+        if (eol == p || *p == '#')
+        {
+            if (eol != p)
+                scan_seq_tag(chunk, p, eol, "#rating_seq,");
+            p = next;
+            continue;
+        }
+
+        CsvField f[CSV_MAX_FIELDS];
+        RatingTotalRow row;
+        char date[20];
+        int n = csv_split(p, eol, f, CSV_MAX_FIELDS);
+        int ok = n >= 7 && csv_copy(&f[0], row.doctor, sizeof(row.doctor));
+        int first = 3; // kolom r1
+        if (ok && n == 7 && memchr(f[1].ptr, '-', f[1].len))
+        {
+            ok = csv_copy(&f[1], date, sizeof(date)) && parse_date(date, &row.day);
+            row.total = row.count = 0;
+            first = 2;
+        }
+        else
+        {
+            row.day = -1;
+            ok = ok && n == 8 && csv_int(&f[1], &row.total) && csv_int(&f[2], &row.count);
+        }
+        for (int i = 0; ok && i < 5; i++)
+            ok = csv_int(&f[first + i], &row.hist[i]);
+
+        if (ok)
+        {
+            to_lowercase(row.doctor);
+            row.hash = hash_function(row.doctor);
+            RatingTotalRow *slot = (RatingTotalRow *)chunk_push(chunk, sizeof(RatingTotalRow));
+            if (slot)
+                *slot = row;
+        }
+        else
+        {
+            chunk->rejected++;
+        }
+        p = next;
+    }
+}
+
+static void *csv_chunk_worker(void *arg)
+{
+    CsvChunk *chunk = (CsvChunk *)arg;
+    chunk->parse(chunk);
+    chunk->done_ms = now_ms();
+    return NULL;
+}
+
+// Memetakan file dan menjalankan parser di beberapa thread, mulai dari
+// byte offset (awal baris; 0 = seluruh file). Tidak menunggu selesai,
+// supaya semua file bisa di-parse bersamaan
+void csv_load_range(CsvLoad *load, const char *filename, CsvParseFn parse, int has_header, size_t offset)
+{
+    memset(load, 0, sizeof(*load));
+    load->filename = filename;
+    load->start_ms = now_ms();
+    load->found = map_file(filename, &load->file);
+    if (!load->found || load->file.size <= offset)
+        return;
+
+    const char *data = load->file.data + offset;
+    size_t size = load->file.size - offset;
+    int n = (int)(size / LOADER_MIN_CHUNK_BYTES) + 1;
+    if (n > cpu_count())
+        n = cpu_count();
+    if (n > LOADER_MAX_CHUNKS)
+        n = LOADER_MAX_CHUNKS;
+
+    const char *begin = data;
+    for (int i = 0; i < n && begin < data + size; i++)
+    {
+        const char *end = data + size;
+        if (i < n - 1)
+        {
+            // Geser batas chunk ke awal baris berikutnya
+            const char *target = data + size * (i + 1) / n;
+            if (target < begin)
+                target = begin;
+            const char *nl = (const char *)memchr(target, '\n', data + size - target);
+            end = nl ? nl + 1 : data + size;
+        }
+
+        CsvChunk *chunk = &load->chunks[load->chunk_count++];
+        chunk->begin = begin;
+        chunk->end = end;
+        chunk->skip_header = (i == 0) && has_header;
+        chunk->parse = parse;
+        chunk->pool.name = reservation_pool.name;
+        chunk->pool.item_size = reservation_pool.item_size;
+        begin = end;
+    }
+
+    // Chunk di-parse di thread pemanggil jika gagal membuat thread
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        CsvChunk *chunk = &load->chunks[i];
+        if (!thread_start(&chunk->thread, csv_chunk_worker, chunk))
+        {
+            chunk->parse(chunk);
+            chunk->done_ms = now_ms();
+            chunk->parse = NULL; // tandai sudah selesai tanpa thread
+        }
+    }
+}
+
+void csv_load_start(CsvLoad *load, const char *filename, CsvParseFn parse, int has_header)
+{
+    csv_load_range(load, filename, parse, has_header, 0);
+}
+
+static void csv_load_wait(CsvLoad *load)
+{
+    double done = load->start_ms;
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        if (load->chunks[i].parse)
+            thread_join(load->chunks[i].thread);
+        load->rows += load->chunks[i].count;
+        load->rejected += load->chunks[i].rejected;
+        if (load->chunks[i].done_ms > done)
+            done = load->chunks[i].done_ms;
+    }
+    load->parse_ms = done - load->start_ms;
+}
+
+static void csv_load_finish(CsvLoad *load, double merge_start)
+{
+    for (int i = 0; i < load->chunk_count; i++)
+        free(load->chunks[i].rows);
+    if (load->found)
+        unmap_file(&load->file);
+    load->merge_ms = now_ms() - merge_start;
+}
+
+// Fungsi untuk membaca data user dari file CSV
+void load_users_from_csv(hash_table *ht, CsvLoad *load)
+{
+    int64_t started = metric_start();
+    csv_load_wait(load);
+    double merge_start = now_ms();
+    if (!load->found)
+        puts("No user data found. Starting fresh.");
+
+    reserve_user_table(ht, ht->count + load->rows);
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        UserRow *rows = (UserRow *)load->chunks[i].rows;
+        for (int j = 0; j < load->chunks[i].count; j++)
+        {
+            // Insert into both hash table and Trie
+            User *u = insert_user_hashed(ht, rows[j].username, rows[j].hash, rows[j].password, rows[j].role);
+            if (u && rows[j].role == ROLE_DOCTOR)
+                insert_trie(trie_root, u);
+        }
+    }
+    csv_load_finish(load, merge_start);
+    metric_stop(METRIC_LOAD_USERS, started);
+}
+
+// Lihat [RESERVATION ARCHIVE]
+int archive_is_purged(const char *username);
+
+// Menggabungkan baris reservasi hasil parse ke AVL pasien dan jadwal
+// dokter. Baris dengan waktu di luar [from, to) dan baris user yang baru
+// dihapus (arsip) dilewati. Return jumlah reservasi yang dimuat
+static int merge_reservation_rows(hash_table *ht, CsvLoad *load, int from, int to)
+{
+    int merged = 0;
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        CsvChunk *chunk = &load->chunks[i];
+        ReservationRow *rows = (ReservationRow *)chunk->rows;
+        for (int j = 0; j < chunk->count; j++)
+        {
+            ReservationNode *res = rows[j].res;
+            if (res->when < from || res->when >= to)
+            {
+                pool_free(&chunk->pool, res);
+                continue;
+            }
+            User *u = find_user_hashed(ht, rows[j].patient, rows[j].hash);
+            res->doctor_id = intern_doctor(rows[j].doctor);
+            if (!u || res->doctor_id < 0 || archive_is_purged(rows[j].patient))
+            {
+                pool_free(&chunk->pool, res); // skip if user not found
+                continue;
+            }
+            res->patient_id = u->id;
+            if (add_reservation(u, res, AVL_ALLOW_DUPLICATES))
+                merged++;
+            else
+                pool_free(&chunk->pool, res);
+        }
+    }
+
+    for (int i = 0; i < load->chunk_count; i++)
+        pool_absorb(&reservation_pool, &load->chunks[i].pool);
+    return merged;
+}
+
+// Memuat snapshot reservasi lalu me-replay journal di atasnya.
+// Setelah itu journal dibuka untuk append event berikutnya
+void load_reservations_from_csv(hash_table *ht, CsvLoad *load, const char *journal_filename)
+{
+    int64_t started = metric_start();
+    csv_load_wait(load);
+    double merge_start = now_ms();
+    if (!load->found)
+        puts("No existing reservation data found.");
+
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        if (load->chunks[i].snapshot_seq > journal.snapshot_seq)
+            journal.snapshot_seq = load->chunks[i].snapshot_seq;
+    }
+    // Baris sebelum cutoff hanya ada jika crash di tengah compaction:
+    // bulannya sudah tersimpan di arsip
+    merge_reservation_rows(ht, load, archive.cutoff, INT_MAX);
+
+    journal.seq = journal.snapshot_seq;
+    replay_journal(ht, journal_filename);
+    journal_open(load->filename, journal_filename);
+    csv_load_finish(load, merge_start);
+    metric_stop(METRIC_LOAD_RESERVATIONS, started);
+}
+
+// Rating di log yang belum tercakup agregat: seq > applied_seq (#rating_seq,
+// atau rating_seq clinic.snap). legacy_applied = baris tanpa seq sudah tercakup
+static void load_rating_log(hash_table *ht, CsvLoad *load, long long applied_seq, int legacy_applied)
+{
+    csv_load_wait(load);
+    double merge_start = now_ms();
+    rating_log.seq = applied_seq;
+    for (int i = 0; i < load->chunk_count; i++)
+    {
+        RatingRow *rows = (RatingRow *)load->chunks[i].rows;
+        for (int j = 0; j < load->chunks[i].count; j++)
+        {
+            if (rows[j].seq > rating_log.seq)
+                rating_log.seq = rows[j].seq;
+            if (rows[j].seq == 0 ? legacy_applied : rows[j].seq <= rating_log.snapshot_seq)
+                continue;
+            rating_log.since_snapshot++;
+            if (rows[j].seq != 0 && rows[j].seq <= applied_seq)
+                continue;
+
+            User *doctor = find_user_hashed(ht, rows[j].doctor, rows[j].hash);
+            if (doctor && doctor->role == ROLE_DOCTOR)
+                apply_rating(doctor, rows[j].rating, rows[j].when);
+        }
+    }
+    trie_refresh_ratings(trie_root);
+    csv_load_finish(load, merge_start);
+
+    // Setelah unmap: compaction mengosongkan file log
+    if (rating_log.since_snapshot >= RATING_COMPACT_THRESHOLD)
+        compact_ratings(ht);
+}
+
+// Agregat dari snapshot, lalu hanya rating di log yang lebih baru dari
+// #rating_seq. Log format lama (tanpa seq) dianggap sudah tercakup jika
+// snapshot ada, dan langsung diringkas jika panjang
+void load_ratings_from_csv(hash_table *ht, CsvLoad *totals, CsvLoad *load)
+{
+    int64_t started = metric_start();
+    csv_load_wait(totals);
+    double merge_start = now_ms();
+    for (int i = 0; i < totals->chunk_count; i++)
+    {
+        CsvChunk *chunk = &totals->chunks[i];
+        if (chunk->snapshot_seq > rating_log.snapshot_seq)
+            rating_log.snapshot_seq = chunk->snapshot_seq;
+
+        RatingTotalRow *rows = (RatingTotalRow *)chunk->rows;
+        for (int j = 0; j < chunk->count; j++)
+        {
+            User *doctor = find_user_hashed(ht, rows[j].doctor, rows[j].hash);
+            if (!doctor || doctor->role != ROLE_DOCTOR)
+                continue;
+            if (rows[j].day >= 0)
+            {
+                RatingBucket *b = rating_bucket(doctor, rows[j].day);
+                if (b)
+                    memcpy(b->hist, rows[j].hist, sizeof(b->hist));
+                continue;
+            }
+            doctor->total_rating = rows[j].total;
+            doctor->rating_count = rows[j].count;
+            memcpy(doctor->rating_hist, rows[j].hist, sizeof(doctor->rating_hist));
+        }
+    }
+    csv_load_finish(totals, merge_start);
+    load_rating_log(ht, load, rating_log.snapshot_seq, totals->found);
+    metric_stop(METRIC_LOAD_RATINGS, started);
+}
+
+// Menampilkan waktu startup dan menambahkannya ke startup_stats.csv
+// (satu baris per start) untuk memantau regresi
+void report_startup(CsvLoad **loads, int n, double total_ms, FILE *out)
+{
+    FILE *stats = fopen("startup_stats.csv", "a");
+    if (stats && ftell(stats) == 0)
+        fprintf(stats, "timestamp,file,rows,chunks,parse_ms,merge_ms,total_ms\n");
+
+    fprintf(out, "=== Startup ===\n");
+    for (int i = 0; i < n; i++)
+    {
+        CsvLoad *load = loads[i];
+        fprintf(out, "%-18s %8d rows  %2d chunks  parse %8.2f ms  merge %8.2f ms\n",
+                load->filename, load->rows, load->chunk_count, load->parse_ms, load->merge_ms);
+        if (load->rejected)
+            fprintf(out, "%-18s %8d rows skipped (invalid or oversized fields)\n", "", load->rejected);
+        if (stats)
+            fprintf(stats, "%lld,%s,%d,%d,%.3f,%.3f,%.3f\n", (long long)time(NULL), load->filename,
+                    load->rows, load->chunk_count, load->parse_ms, load->merge_ms, total_ms);
+    }
+    fprintf(out, "Total startup: %.2f ms (%d CPU)\n", total_ms, cpu_count());
+
+    if (stats)
+        fclose(stats);
+}
+
+// Pause console untuk menunggu input dari user
+void pause_console(void)
+{
+    printf("Press any key to continue...");
+    term_getch();
+    printf("\n");
+}
+
+// ======================= [RESERVATION ARCHIVE] =======================
+// Hanya bulan berjalan dan bulan-bulan berikutnya yang resident. Setiap
+// compaction memindahkan bulan yang sudah lewat ke satu segment CSV per
+// bulan (format sama dengan reservations.csv) lalu membuangnya dari
+// memori. archive/index.csv mencatat bulan yang ada di arsip dan cutoff;
+// file ini ditulis sebelum reservations.csv sehingga baris/event journal
+// sebelum cutoff selalu dianggap sudah ada di segment.
+// Bulan yang diarsipkan hanya bisa dibaca: booking dan pembatalan ditolak.
+// Hapus user tidak memuat arsip: username dicatat di archive.purged,
+// barisnya dilewati saat segment dimuat dan dibuang dari file saat
+// compaction berikutnya
+
+static void archive_path(int month, char *buf, size_t cap)
+{
+    char name[11];
+    format_month(month, name);
+    snprintf(buf, cap, "%s/reservations-%s.csv", archive.dir, name);
+}
+
+static ArchiveMonth *archive_find(int month)
+{
+    for (int i = 0; i < archive.count; i++)
+    {
+        if (archive.months[i].month == month)
+            return &archive.months[i];
+    }
+    return NULL;
+}
+
+// Menambah bulan baru ke daftar (tetap urut)
+static ArchiveMonth *archive_add(int month)
+{
+    ArchiveMonth *m = archive_find(month);
+    if (m)
+        return m;
+    if (archive.count == archive.capacity)
+    {
+        int capacity = archive.capacity ? archive.capacity * 2 : 16;
+        ArchiveMonth *months = (ArchiveMonth *)realloc(archive.months, capacity * sizeof(ArchiveMonth));
+        if (!months)
+            return NULL;
+        archive.months = months;
+        archive.capacity = capacity;
+    }
+    int i = archive.count++;
+    for (; i > 0 && archive.months[i - 1].month > month; i--)
+        archive.months[i] = archive.months[i - 1];
+    m = &archive.months[i];
+    m->month = month;
+    m->rows = 0;
+    m->loaded = 0;
+    return m;
+}
+
+// Membaca archive/index.csv: "#cutoff,YYYY-MM" lalu "YYYY-MM,rows" per
+// bulan. Dipanggil sebelum data lain dimuat
+void archive_load_index(void)
+{
+    char path[260];
+    snprintf(path, sizeof(path), "%s/index.csv", archive.dir);
+    FILE *file = fopen(path, "r");
+    if (!file)
+        return;
+
+    char line[128];
+    while (fgets(line, sizeof(line), file))
+    {
+        CsvField f[2];
+        const char *eol = line + strcspn(line, "\r\n");
+        char month_text[11];
+        int month, rows;
+        if (csv_split(line, eol, f, 2) != 2 || !csv_copy(&f[1], month_text, sizeof(month_text)))
+            continue;
+        if (f[0].len == 7 && memcmp(f[0].ptr, "#cutoff", 7) == 0)
+        {
+            if (parse_month(month_text, &month))
+                archive.cutoff = month_start(month);
+        }
+        else if (csv_copy(&f[0], month_text, sizeof(month_text)) && parse_month(month_text, &month) &&
+                 csv_int(&f[1], &rows))
+        {
+            ArchiveMonth *m = archive_add(month);
+            if (m)
+                m->rows = rows;
+        }
+    }
+    fclose(file);
+}
+
+static int archive_save_index(int cutoff)
+{
+    char path[260], tmp_path[270];
+    snprintf(path, sizeof(path), "%s/index.csv", archive.dir);
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "w");
+    if (!file)
+        return 0;
+
+    char month[11];
+    format_month(month_of(cutoff), month);
+    fprintf(file, "month,rows\n#cutoff,%s\n", month);
+    for (int i = 0; i < archive.count; i++)
+    {
+        format_month(archive.months[i].month, month);
+        fprintf(file, "%s,%d\n", month, archive.months[i].rows);
+    }
+    if (!sync_file(file))
+    {
+        fclose(file);
+        return 0;
+    }
+    fclose(file);
+    return replace_file(tmp_path, path);
+}
+
+// Menulis semua reservasi satu bulan (urut waktu) sebagai segment baru
+static int archive_write_month(int month, ReservationNode **rows, int n)
+{
+    char path[260], tmp_path[270];
+    archive_path(month, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "w");
+    if (!file)
+        return 0;
+
+    fprintf(file, "username,date,time,doctor,notes\n");
+    for (int i = 0; i < n; i++)
+    {
+        char date[11], time[6];
+        format_when(rows[i]->when, date, time);
+        char quoted[2 * sizeof(rows[i]->notes) + 2];
+        fprintf(file, "%s,%s,%s,%s,%s\n", user_name(rows[i]->patient_id), date, time,
+                doctor_name(rows[i]->doctor_id), csv_quote(rows[i]->notes, quoted, sizeof(quoted)));
+    }
+    if (!sync_file(file))
+    {
+        fclose(file);
+        remove(tmp_path);
+        return 0;
+    }
+    fclose(file);
+    if (!replace_file(tmp_path, path))
+    {
+        remove(tmp_path);
+        return 0;
+    }
+    return 1;
+}
+
+// Reservasi pada waktu when ada di bulan yang sudah diarsipkan. cutoff
+// hanya diubah di bawah table_lock exclusive, tapi dibaca juga sebelum
+// request batch memilih jenis lock
+int archive_is_closed(int when)
+{
+    return when < __atomic_load_n(&archive.cutoff, __ATOMIC_RELAXED);
+}
+
+static int archive_load_month(hash_table *ht, ArchiveMonth *m)
+{
+    char path[260];
+    archive_path(m->month, path, sizeof(path));
+    CsvLoad load;
+    csv_load_start(&load, path, parse_reservation_chunk, 1);
+    csv_load_wait(&load);
+    if (!load.found)
+        fprintf(stderr, "Archive segment %s is missing.\n", path);
+    double merge_start = now_ms();
+    int rows = merge_reservation_rows(ht, &load, month_start(m->month), month_start(m->month + 1));
+    csv_load_finish(&load, merge_start);
+    m->loaded = 1;
+    return rows;
+}
+
+// Memuat semua bulan arsip yang beririsan dengan [from, to] untuk query
+// riwayat/laporan. Bulan tetap resident sampai compaction berikutnya.
+// Pemanggil memegang table_lock exclusive (atau satu-satunya thread yang
+// mengubah data, seperti menu interaktif). Return jumlah bulan yang dimuat
+int archive_load_range(hash_table *ht, int from, int to)
+{
+    if (!archive_is_closed(from))
+        return 0;
+    int64_t started = metric_start();
+    int loaded = 0;
+    for (int i = 0; i < archive.count; i++)
+    {
+        ArchiveMonth *m = &archive.months[i];
+        if (m->loaded || month_start(m->month + 1) <= from || month_start(m->month) > to)
+            continue;
+        archive_load_month(ht, m);
+        loaded++;
+    }
+    if (loaded)
+        metric_stop(METRIC_LOAD_ARCHIVE, started);
+    return loaded;
+}
+
+// Dipanggil remove_user: reservasi user ini di segment arsip ikut terhapus
+// tanpa memuat bulannya (lihat archive_purge_segments)
+void archive_purge_user(const char *username)
+{
+    if (!archive.count)
+        return; // belum ada segment, baris resident sudah di-free
+    if (archive.purged_count == archive.purged_capacity)
+    {
+        int capacity = archive.purged_capacity ? archive.purged_capacity * 2 : 16;
+        char(*purged)[20] = (char(*)[20])realloc(archive.purged, capacity * sizeof(*purged));
+        if (!purged)
+        {
+            puts("Failed to record deleted user for the archive.");
+            return;
+        }
+        archive.purged = purged;
+        archive.purged_capacity = capacity;
+    }
+    strncpy(archive.purged[archive.purged_count], username, sizeof(archive.purged[0]) - 1);
+    archive.purged[archive.purged_count][sizeof(archive.purged[0]) - 1] = '\0';
+    archive.purged_count++;
+}
+
+// Username sudah dihapus tapi barisnya mungkin masih ada di segment.
+// User baru dengan nama yang sama belum punya baris di arsip (bulan
+// tertutup tidak bisa dibooking), jadi cocok nama saja cukup
+int archive_is_purged(const char *username)
+{
+    for (int i = 0; i < archive.purged_count; i++)
+    {
+        if (strcmp(archive.purged[i], username) == 0)
+            return 1;
+    }
+    return 0;
+}
+
+// Menulis ulang satu segment tanpa baris user di archive.purged, dibaca
+// per baris (bulan tidak dimuat ke memori). Return jumlah baris yang
+// tersisa, -1 jika gagal menulis (segment lama tetap utuh)
+static int archive_purge_month(const ArchiveMonth *m)
+{
+    char path[260], tmp_path[270];
+    archive_path(m->month, path, sizeof(path));
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *in = fopen(path, "r");
+    if (!in)
+        return m->rows; // tidak bisa dibaca: dibiarkan, dilaporkan saat dimuat
+    FILE *out = fopen(tmp_path, "w");
+    if (!out)
+    {
+        fclose(in);
+        return -1;
+    }
+
+    char line[1024]; // baris segment (lihat archive_write_month) jauh lebih pendek
+    int removed = 0, rows = 0;
+    for (int header = 1; fgets(line, sizeof(line), in); header = 0)
+    {
+        const char *p = line;
+        CsvField f;
+        char username[20];
+        if (!header && csv_next_field(&p, line + strcspn(line, "\r\n"), &f) &&
+            csv_copy(&f, username, sizeof(username)) && archive_is_purged(username))
+        {
+            removed++;
+            continue;
+        }
+        rows += !header;
+        fputs(line, out);
+    }
+    fclose(in);
+    if (!removed)
+    {
+        fclose(out);
+        remove(tmp_path);
+        return rows;
+    }
+    if (!sync_file(out))
+    {
+        fclose(out);
+        return -1;
+    }
+    fclose(out);
+    return replace_file(tmp_path, path) ? rows : -1;
+}
+
+// Membuang baris user yang dihapus dari semua segment yang sudah ada,
+// sebelum bulan baru ditulis (bulan baru dari memori sudah bersih).
+// Bulan yang jadi kosong dihapus dari daftar. Return 0 jika gagal
+static int archive_purge_segments(void)
+{
+    if (!archive.purged_count)
+        return 1;
+    int kept = 0;
+    for (int i = 0; i < archive.count; i++)
+    {
+        ArchiveMonth m = archive.months[i];
+        int rows = archive_purge_month(&m);
+        if (rows < 0)
+        {
+            // Sisa daftar dipertahankan apa adanya
+            for (; i < archive.count; i++)
+                archive.months[kept++] = archive.months[i];
+            archive.count = kept;
+            return 0;
+        }
+        m.rows = rows;
+        if (!m.rows)
+        {
+            char path[260];
+            archive_path(m.month, path, sizeof(path));
+            remove(path);
+            continue;
+        }
+        archive.months[kept++] = m;
+    }
+    archive.count = kept;
+    return 1;
+}
+
+// Sudah ganti bulan sejak cutoff terakhir: compaction perlu memindahkan
+// bulan lalu ke arsip
+int archive_due(void)
+{
+    return archive.cutoff < month_start(month_of(current_when()));
+}
+
+static int compare_archive_rows(const void *a, const void *b)
+{
+    return compare_reservation_key(*(ReservationNode *const *)a, *(ReservationNode *const *)b);
+}
+
+// Memindahkan semua reservasi resident sebelum bulan berjalan ke arsip:
+// baris user yang dihapus dibuang dari segment lama, bulan baru ditulis ke
+// segment, index diperbarui, lalu node-nya dibuang dari memori (bulan
+// arsip yang sedang dimuat langsung dibuang). Jika ada yang gagal
+// ditulis, semua tetap resident.
+// Pemanggil memegang table_lock exclusive dan sudah snapshot_release
+void archive_close_months(void)
+{
+    int cutoff = month_start(month_of(current_when()));
+    if (cutoff < archive.cutoff)
+        cutoff = archive.cutoff; // jam mundur: bulan yang sudah ditutup tetap tertutup
+
+    ReservationStore *st = &reservation_store;
+    ReservationNode **closed = (ReservationNode **)malloc((st->count + 1) * sizeof(ReservationNode *));
+    if (!closed || !make_dir(archive.dir))
+    {
+        puts("Failed to archive past reservations.");
+        free(closed);
+        return;
+    }
+    int n = 0;
+    for (int i = 0; i < st->count; i++)
+    {
+        if (st->when[i] < cutoff)
+            closed[n++] = st->node[i];
+    }
+    qsort(closed, n, sizeof(ReservationNode *), compare_archive_rows);
+
+    int ok = archive_purge_segments();
+    for (int i = 0, j; ok && i < n; i = j)
+    {
+        int month = month_of(closed[i]->when);
+        for (j = i; j < n && month_of(closed[j]->when) == month; j++)
+            ;
+        ArchiveMonth *m = archive_find(month);
+        if (m && m->loaded)
+            continue; // dimuat dari segment, isi di disk sudah sama
+        int added = !m;
+        ok = (m || (m = archive_add(month))) && archive_write_month(month, closed + i, j - i);
+        if (ok)
+        {
+            m->rows = j - i;
+        }
+        else if (m && added)
+        {
+            // Bulan belum punya segment: jangan sampai compaction berikutnya
+            // menganggapnya sudah tertulis
+            int k = (int)(m - archive.months);
+            memmove(m, m + 1, (archive.count - k - 1) * sizeof(ArchiveMonth));
+            archive.count--;
+        }
+    }
+    if (!ok || !archive_save_index(cutoff))
+    {
+        puts("Failed to archive past reservations.");
+        free(closed);
+        return;
+    }
+
+    __atomic_store_n(&archive.cutoff, cutoff, __ATOMIC_RELAXED);
+    archive.purged_count = 0;
+    for (int i = 0; i < archive.count; i++)
+        archive.months[i].loaded = 0;
+    for (int i = 0; i < n; i++)
+        remove_reservation(user_index.by_id[closed[i]->patient_id], closed[i]);
+    free(closed);
+}
+
+// ======================= [OPERATIONS] =======================
+// Operasi inti tanpa I/O console. Dipakai menu interaktif, batch mode dan
+// server, semuanya mengembalikan OP_* (OP_OK jika berhasil).
+// Pemanggil memegang table_lock (shared, kecuali disebut exclusive);
+// lock user & jadwal dokter diambil sendiri oleh operasi di sini
+
+static mutex_t *user_lock(const User *u)
+{
+    return &user_locks[hash_function(u->username) & (USER_LOCK_STRIPES - 1)];
+}
+
+const char *op_status_name(int status)
+{
+    switch (status)
+    {
+    case OP_OK:
+        return "ok";
+    case OP_INVALID:
+        return "invalid";
+    case OP_NOT_FOUND:
+        return "not_found";
+    case OP_EXISTS:
+        return "exists";
+    case OP_UNAVAILABLE:
+        return "unavailable";
+    case OP_SLOT_TAKEN:
+        return "slot_taken";
+    case OP_DUPLICATE:
+        return "duplicate";
+    case OP_FORBIDDEN:
+        return "forbidden";
+    case OP_NO_MEMORY:
+        return "no_memory";
+    case OP_ARCHIVED:
+        return "archived";
+    }
+    return "error";
+}
+
+// Username/password disimpan apa adanya di CSV dan journal,
+// jadi tidak boleh kosong, terlalu panjang, berisi spasi atau koma
+static int valid_credential(const char *s)
+{
+    int len = 0;
+    for (; s[len]; len++)
+    {
+        if (!isgraph((unsigned char)s[len]) || s[len] == ',')
+            return 0;
+    }
+    return len > 0 && len < 20;
+}
+
+// Pemanggil memegang table_lock exclusive (atau satu-satunya thread yang
+// mengubah data, seperti menu interaktif dengan table_lock shared)
+int register_client_account(hash_table *ht, const char *username, const char *password)
+{
+    if (!valid_credential(username) || !valid_credential(password))
+        return OP_INVALID;
+    unsigned int hash = hash_function(username);
+    if (find_user_hashed(ht, username, hash))
+        return OP_EXISTS;
+    if (!insert_user_hashed(ht, username, hash, password, ROLE_CLIENT))
+        return OP_NO_MEMORY;
+
+    save_user_to_csv(username, password, ROLE_CLIENT);
+    return OP_OK;
+}
+
+// NULL jika username tidak ada atau password salah
+User *authenticate(hash_table *ht, const char *username, const char *password)
+{
+    User *u = find_user(ht, username);
+    return u && strcmp(u->password, password) == 0 ? u : NULL;
+}
+
+int find_bookable_doctor(hash_table *ht, const char *name, User **doctor)
+{
+    *doctor = find_user(ht, name);
+    if (!*doctor || (*doctor)->role != ROLE_DOCTOR)
+        return OP_NOT_FOUND;
+    return (*doctor)->available ? OP_OK : OP_UNAVAILABLE;
+}
+
+// Pemanggil memegang lock user u dan lock jadwal dokter
+static int book_reservation_locked(User *u, DoctorSchedule *schedule, ReservationNode *res,
+                                   int when, const char *notes, int *next_free)
+{
+    // Satu slot 15 menit hanya untuk satu pasien per dokter
+    if (slot_is_taken(schedule, when))
+    {
+        if (next_free)
+            *next_free = next_free_slot(schedule, when);
+        return OP_SLOT_TAKEN;
+    }
+
+    res->when = when;
+    res->doctor_id = schedule->id;
+    res->patient_id = u->id;
+    res->snapshot_row = -1;
+    strncpy(res->notes, notes, sizeof(res->notes) - 1);
+    res->notes[sizeof(res->notes) - 1] = '\0';
+    for (char *c = res->notes; *c; c++)
+    {
+        if (*c == '\n' || *c == '\r') // satu event journal = satu baris
+            *c = ' ';
+    }
+
+    if (!add_reservation(u, res, AVL_UNIQUE))
+        return OP_DUPLICATE;
+
+    char date[11], time[6];
+    format_when(res->when, date, time);
+    char quoted[2 * sizeof(res->notes) + 2];
+    journal_append("C,%s,%s,%s,%s,%s", u->username, date, time, schedule->doctor,
+                   csv_quote(res->notes, quoted, sizeof(quoted)));
+    return OP_OK;
+}
+
+// Membuat reservasi u ke dokter pada waktu when lalu mencatatnya di journal.
+// Jika slot terisi, *next_free (boleh NULL) diisi slot kosong berikutnya
+int book_reservation(hash_table *ht, User *u, const char *doctor_name, int when, const char *notes, int *next_free)
+{
+    if (archive_is_closed(when))
+        return OP_ARCHIVED;
+    User *doctor;
+    int status = find_bookable_doctor(ht, doctor_name, &doctor);
+    if (status != OP_OK)
+        return status;
+
+    // Server meng-intern semua dokter sebelum menerima koneksi
+    // (server_prepare), jadi di sana doctor_index tidak pernah tumbuh
+    DoctorSchedule *schedule = find_doctor_schedule(doctor->username, 1);
+    if (!schedule)
+        return OP_NO_MEMORY;
+    snapshot_fill_schedule(schedule);
+    ReservationNode *res = (ReservationNode *)pool_alloc(&reservation_pool);
+    if (!res)
+        return OP_NO_MEMORY;
+
+    // Cek slot dan insert di bawah lock dokter yang sama supaya dua pasien
+    // tidak bisa lolos cek untuk slot yang sama
+    mutex_lock(user_lock(u));
+    mutex_lock(&schedule->lock);
+    status = book_reservation_locked(u, schedule, res, when, notes, next_free);
+    mutex_unlock(&schedule->lock);
+    mutex_unlock(user_lock(u));
+    if (status != OP_OK)
+        pool_free(&reservation_pool, res);
+    return status;
+}
+
+// Pemanggil memegang lock user u
+static void cancel_booking_locked(User *u, ReservationNode *res)
+{
+    DoctorSchedule *schedule = doctor_index.by_id[res->doctor_id];
+    char date[11], time[6];
+    format_when(res->when, date, time);
+
+    mutex_lock(&schedule->lock);
+    journal_append("X,%s,%s,%s,%s", u->username, date, time, schedule->doctor);
+    remove_reservation(u, res);
+    mutex_unlock(&schedule->lock);
+}
+
+// Membatalkan reservasi milik u (dicatat di journal lalu di-free)
+void cancel_booking(User *u, ReservationNode *res)
+{
+    mutex_lock(user_lock(u));
+    cancel_booking_locked(u, res);
+    mutex_unlock(user_lock(u));
+}
+
+int cancel_reservation_at(User *u, int when, const char *doctor)
+{
+    if (archive_is_closed(when))
+        return OP_ARCHIVED;
+    DoctorSchedule *schedule = find_doctor_schedule(doctor, 0);
+    if (!schedule)
+        return OP_NOT_FOUND;
+
+    mutex_lock(user_lock(u));
+    ReservationNode *res = find_reservation(u, when, schedule->id);
+    if (res)
+        cancel_booking_locked(u, res);
+    mutex_unlock(user_lock(u));
+    return res ? OP_OK : OP_NOT_FOUND;
+}
+
+// Jumlah reservasi milik u
+int count_reservations(User *u)
+{
+    mutex_lock(user_lock(u));
+    int count = avl_size(u->reservations);
+    mutex_unlock(user_lock(u));
+    return count;
+}
+
+// Menambah rating 1-5 untuk dokter; *average (boleh NULL) diisi rata-rata baru
+int rate_doctor_by_name(hash_table *ht, const char *name, int rating, float *average)
+{
+    if (rating < 1 || rating > 5)
+        return OP_INVALID;
+
+    char lowered[50];
+    strncpy(lowered, name, sizeof(lowered) - 1);
+    lowered[sizeof(lowered) - 1] = '\0';
+    to_lowercase(lowered);
+
+    User *doctor = find_user(ht, lowered);
+    if (!doctor || doctor->role != ROLE_DOCTOR)
+        return OP_NOT_FOUND;
+
+    mutex_lock(user_lock(doctor));
+    int when = current_when();
+    apply_rating(doctor, rating, when);
+    float avg = (float)doctor->total_rating / doctor->rating_count;
+    trie_update_rating(trie_root, doctor, avg);
+    if (average)
+        *average = avg;
+    mutex_unlock(user_lock(doctor));
+    save_rating_to_csv(doctor->username, rating, when);
+    return OP_OK;
+}
+
+// Pemanggil memegang table_lock exclusive (lihat register_client_account)
+int delete_user_account(hash_table *ht, const char *username)
+{
+    if (!remove_user(ht, username))
+        return OP_NOT_FOUND;
+    journal_append("D,%s", username);
+    return OP_OK;
+}
+
+// ======================= [ADMIN FUNCTIONS] =======================
+
+static void print_user_row(const char *username, int role)
+{
+    const char *role_str = (role == ROLE_ADMIN) ? "Admin" : (role == ROLE_DOCTOR) ? "Doctor"
+                                                                                : "Client";
+    printf("Username: %.19s | Role: %s\n", username, role_str);
+}
+
+// Fungsi untuk menampilkan semua user
+// yang ada di hash table, ditambah user clinic.snap yang belum
+// di-materialize (dibaca langsung dari record di file)
+void view_all_users(hash_table *ht)
+{
+    puts("=== List of Users ===");
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *cur = ht->slots[i].user;
+        if (cur)
+            print_user_row(cur->username, cur->role);
+    }
+
+    mutex_lock(&snapshot.lock);
+    for (int i = 0; snapshot.header && i < snapshot.header->user_count; i++)
+    {
+        if (snapshot.user_state[i] == SNAPSHOT_USER_MAPPED)
+            print_user_row(snapshot.users[i].username, snapshot.users[i].role);
+    }
+    mutex_unlock(&snapshot.lock);
+}
+
+// Fungsi untuk menghapus user berdasarkan username
+// Jika user ditemukan, akan menghapus user dan semua reservasi yang dimilikinya
+// Jika tidak ditemukan, akan menampilkan pesan error
+void delete_user(hash_table *ht, const char *username)
+{
+    if (delete_user_account(ht, username) != OP_OK)
+    {
+        printf("User '%s' not found.\n", username);
+        return;
+    }
+    printf("User '%s' has been deleted.\n", username);
+}
+
+// Satu baris laporan janji (report & query rentang waktu)
+static void write_report_row(BufferedWriter *w, const ReservationNode *res)
+{
+    char date[11], time[6];
+    format_when(res->when, date, time);
+    writer_printf(w, "Date: %s | Time: %s | Doctor: %s | Patient: %s | Notes: %s\n",
+                  date,
+                  time,
+                  doctor_name(res->doctor_id),
+                  user_name(res->patient_id),
+                  res->notes);
+}
+
+// Merge cursor semua dokter ke out (lihat generate_report_with_heap)
+static int write_report(ReservationHeap *heap, int from, int to, int limit, FILE *out)
+{
+    for (int i = 0; i < doctor_index.capacity; i++)
+    {
+        DoctorSchedule *s = doctor_index.slots[i];
+        if (!s || !s->appointments)
+            continue;
+
+        AVLCursor *cursor = (AVLCursor *)arena_alloc(&scratch_arena, sizeof(AVLCursor));
+        if (!cursor)
+            break;
+        avl_cursor_seek(cursor, s->appointments, from);
+        if (avl_cursor_peek(cursor))
+            insert_heap(heap, cursor);
+    }
+
+    BufferedWriter writer;
+    writer.out = out;
+    writer.len = 0;
+
+    int rows = 0;
+    writer_printf(&writer, "=== Upcoming Appointments Report ===\n");
+    while (heap->size > 0 && (limit <= 0 || rows < limit))
+    {
+        ReservationNode *res = avl_cursor_peek(heap->data[0]);
+        if (res->when > to)
+            break; // puncak heap adalah yang paling awal, sisanya pasti lebih lambat
+
+        write_report_row(&writer, res);
+        rows++;
+        advance_heap_top(heap);
+    }
+
+    if (rows == 0)
+        writer_printf(&writer, "No reservations to report.\n");
+    else
+        writer_printf(&writer, "(%d appointments)\n", rows);
+    writer_flush(&writer);
+    if (out)
+        fflush(out);
+    return rows;
+}
+
+// Laporan janji mendatang secara streaming: k-way merge dari jadwal
+// semua dokter (masing-masing sudah terurut di doctor_index) memakai
+// min-heap berisi satu cursor per dokter. Memori O(jumlah dokter).
+// Hanya reservasi dengan from <= when <= to; limit <= 0 = semua.
+// out NULL = laporan tidak ditulis. Return jumlah baris laporan
+int generate_report_with_heap(int from, int to, int limit, FILE *out)
+{
+    // Cursor menunjuk ke semua jadwal sekaligus, jadi semua dokter dikunci
+    // (urut id) selama merge; scratch_arena dijaga report_lock
+    int64_t started = metric_start();
+    snapshot_fill_schedules();
+    mutex_lock(&report_lock);
+    for (int i = 0; i < doctor_index.count; i++)
+        mutex_lock(&doctor_index.by_id[i]->lock);
+
+    ReservationHeap heap;
+    heap.size = 0;
+    heap.data = (AVLCursor **)arena_alloc(&scratch_arena, (doctor_index.count + 1) * sizeof(AVLCursor *));
+    int rows = heap.data ? write_report(&heap, from, to, limit, out) : 0;
+    arena_reset(&scratch_arena);
+
+    for (int i = doctor_index.count - 1; i >= 0; i--)
+        mutex_unlock(&doctor_index.by_id[i]->lock);
+    mutex_unlock(&report_lock);
+    metric_stop(METRIC_REPORT, started);
+    return rows;
+}
+
+// Menampilkan maksimal k dokter dengan rating tertinggi di subtree node
+void print_rating_trie(TrieNode *node, int k)
+{
+    TrieNode *top[TRIE_TOP_K];
+    if (k > TRIE_TOP_K)
+        k = TRIE_TOP_K;
+
+    int n = trie_top_k(node, top, k);
+    for (int i = 0; i < n; i++)
+    {
+        User *u = top[i]->doctor;
+        if (u->rating_count > 0)
+            printf("- %s - Avg Rating: %.2f (%d ratings)\n", u->username, top[i]->rating, u->rating_count);
+        else
+            printf("- %s - No ratings yet\n", u->username);
+    }
+}
+void insert_user_and_trie(hash_table *ht, TrieNode *trie, const char *username, const char *password, int role)
+{
+    char lowered[20];
+    strncpy(lowered, username, sizeof(lowered));
+    lowered[sizeof(lowered) - 1] = '\0';
+    to_lowercase(lowered);
+
+    User *u = insert_user_hashed(ht, lowered, hash_function(lowered), password, role); // lowercase stored in hash table
+    if (u && role == ROLE_DOCTOR)
+        insert_trie(trie, u); // and in Trie
+}
+void search_rating_by_prefix(TrieNode *root, const char *prefix)
+{
+    char lowered[20];
+    strncpy(lowered, prefix, sizeof(lowered));
+    lowered[sizeof(lowered) - 1] = '\0';
+    to_lowercase(lowered);
+
+    int exact;
+    rwlock_read_lock(&trie_lock);
+    TrieNode *node = trie_find_prefix(root, lowered, &exact);
+    if (!node || (!node->doctor && node->child_count == 0))
+        printf("No doctor found with prefix '%s'.\n", prefix);
+    else
+    {
+        printf("Top doctors matching '%s':\n", prefix);
+        print_rating_trie(node, TRIE_TOP_K);
+    }
+    rwlock_read_unlock(&trie_lock);
+}
+
+// Mengumpulkan dokter di subtree node. Caller memegang trie_lock
+static void trie_collect(TrieNode *node, RatingSummaryRow **rows, int *count, int *cap)
+{
+    if (node->doctor)
+    {
+        if (*count == *cap)
+        {
+            int new_cap = *cap ? *cap * 2 : 64;
+            RatingSummaryRow *grown = (RatingSummaryRow *)realloc(*rows, new_cap * sizeof(RatingSummaryRow));
+            if (!grown)
+                return;
+            *rows = grown;
+            *cap = new_cap;
+        }
+        (*rows)[(*count)++].doctor = node->doctor;
+    }
+    for (int i = 0; i < node->child_count; i++)
+        trie_collect(node->children[i], rows, count, cap);
+}
+
+static int compare_summary_rows(const void *a, const void *b)
+{
+    const RatingSummaryRow *x = (const RatingSummaryRow *)a;
+    const RatingSummaryRow *y = (const RatingSummaryRow *)b;
+    if (x->decayed != y->decayed)
+        return x->decayed < y->decayed ? 1 : -1;
+    return (x->weight < y->weight) - (x->weight > y->weight);
+}
+
+// Tabel rating dokter berawalan prefix: all-time, RATING_WINDOW_DAYS hari
+// terakhir (rata-rata, median, p10) dan rata-rata ber-decay sebagai urutan
+void print_rating_summary(TrieNode *root, const char *prefix)
+{
+    RatingSummaryRow *rows = NULL;
+    int count = 0, cap = 0, exact;
+
+    rwlock_read_lock(&trie_lock);
+    TrieNode *node = trie_find_prefix(root, prefix, &exact);
+    if (node)
+        trie_collect(node, &rows, &count, &cap);
+    rwlock_read_unlock(&trie_lock);
+
+    int today = current_when() / MINUTES_PER_DAY;
+    for (int i = 0; i < count; i++)
+    {
+        User *u = rows[i].doctor;
+        mutex_lock(user_lock(u));
+        rating_window(u, today, RATING_WINDOW_DAYS, &rows[i].window);
+        rows[i].decayed = rating_decayed(u, today, &rows[i].weight);
+        mutex_unlock(user_lock(u));
+    }
+    qsort(rows, count, sizeof(RatingSummaryRow), compare_summary_rows);
+
+    printf("\n%-19s %-15s %-15s %-4s %-4s %s\n", "Doctor", "All-time", "Last 30 days", "p50", "p10", "Decayed (weight)");
+    for (int i = 0; i < count; i++)
+    {
+        User *u = rows[i].doctor;
+        const RatingWindow *w = &rows[i].window;
+        char all[32] = "-", recent[32] = "-", p50[4] = "-", p10[4] = "-", decayed[32] = "-";
+        if (u->rating_count)
+            snprintf(all, sizeof(all), "%.2f (%d)", (float)u->total_rating / u->rating_count, u->rating_count);
+        if (w->count)
+        {
+            snprintf(recent, sizeof(recent), "%.2f (%d)", w->average, w->count);
+            snprintf(p50, sizeof(p50), "%d", rating_percentile(w, 50));
+            snprintf(p10, sizeof(p10), "%d", rating_percentile(w, 10));
+        }
+        if (rows[i].decayed >= 0)
+            snprintf(decayed, sizeof(decayed), "%.2f (%.1f)", rows[i].decayed, rows[i].weight);
+        printf("%-19s %-15s %-15s %-4s %-4s %s\n", u->username, all, recent, p50, p10, decayed);
+    }
+    if (count == 0)
+        puts("No doctors to summarize.");
+    free(rows);
+}
+
+// Laporan analitik dari reservation_store untuk hari [from_day, to_day]:
+// booking & utilisasi per dokter, total per hari dan sebaran jam
+void booking_analytics(int from_day, int to_day)
+{
+    int days = to_day - from_day + 1;
+    int doctors = doctor_index.count;
+    if (days < 1 || days > ANALYTICS_MAX_DAYS)
+    {
+        printf("Range must be 1-%d days.\n", ANALYTICS_MAX_DAYS);
+        return;
+    }
+
+    snapshot_fill_schedules(); // kolom reservasi diisi saat jadwal dimuat
+    int *counts = (int *)malloc(((size_t)doctors * days + 1) * sizeof(int));
+    int *unique = (int *)malloc((doctors ? doctors : 1) * sizeof(int));
+    int *per_day = (int *)calloc(days, sizeof(int));
+    if (!counts || !unique || !per_day)
+    {
+        puts("Memory allocation failed");
+        free(counts);
+        free(unique);
+        free(per_day);
+        return;
+    }
+    int hours[25];
+    int64_t started = metric_start(); // hanya scan kolom, bukan output ke layar
+    store_count_by_doctor_day(from_day, days, doctors, counts);
+    store_unique_patients(from_day, days, doctors, unique);
+    store_count_by_hour(from_day, days, hours);
+    metric_stop(METRIC_ANALYTICS, started);
+
+    int capacity = days * CLINIC_OPEN_HOURS * 60 / SLOT_MINUTES;
+    long long total = 0;
+    printf("\n%-19s %8s %8s %8s %9s %11s\n", "Doctor", "Bookings", "Patients", "Peak/day", "Active", "Utilization");
+    for (int d = 0; d < doctors; d++)
+    {
+        const int *row = counts + (size_t)d * days;
+        int sum = 0, peak = 0, active = 0;
+        for (int i = 0; i < days; i++)
+        {
+            sum += row[i];
+            per_day[i] += row[i];
+            peak = row[i] > peak ? row[i] : peak;
+            active += row[i] > 0;
+        }
+        if (sum == 0)
+            continue;
+        total += sum;
+        printf("%-19.19s %8d %8d %8d %4d/%-4d %10.1f%%\n", doctor_name(d), sum, unique[d], peak,
+               active, days, 100.0 * sum / capacity);
+    }
+    printf("Total bookings: %lld (utilization assumes %d open hours/day, %d-minute slots)\n",
+           total, CLINIC_OPEN_HOURS, SLOT_MINUTES);
+
+    puts("\nBookings per day:");
+    for (int i = 0; i < days; i++)
+    {
+        if (!per_day[i])
+            continue;
+        char date[11], time[6];
+        format_when((from_day + i) * MINUTES_PER_DAY, date, time);
+        printf("  %s %6d\n", date, per_day[i]);
+    }
+
+    int busiest = 1;
+    for (int h = 0; h < 24; h++)
+        busiest = hours[h] > busiest ? hours[h] : busiest;
+    puts("\nBookings by hour:");
+    for (int h = 0; h < 24; h++)
+    {
+        if (!hours[h])
+            continue;
+        printf("  %02d:00 %6d ", h, hours[h]);
+        for (int i = 0; i < hours[h] * 40 / busiest; i++)
+            putchar('#');
+        putchar('\n');
+    }
+
+    free(counts);
+    free(unique);
+    free(per_day);
+}
+
+// Kalender satu bulan dari index terurut waktu (root = by_time atau jadwal
+// satu dokter): jumlah janji per hari lewat avl_count_range, O(hari * log n)
+static void print_month_calendar(AVLNode *root, int month, const char *title)
+{
+    static const char *const weekdays[] = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+    int first_day = month_start(month) / MINUTES_PER_DAY;
+    int days = month_start(month + 1) / MINUTES_PER_DAY - first_day;
+    int offset = ((first_day + 3) % 7 + 7) % 7; // 1970-01-01 hari Kamis
+
+    char label[11];
+    format_month(month, label);
+    printf("=== Appointment Calendar %s (%s) ===\n", label, title);
+    for (int i = 0; i < 7; i++)
+        printf("%9s", weekdays[i]);
+    putchar('\n');
+    for (int i = 0; i < offset; i++)
+        printf("%9s", "");
+    int busiest = 0, busiest_count = 0;
+    for (int d = 0; d < days; d++)
+    {
+        int from = (first_day + d) * MINUTES_PER_DAY;
+        int count = avl_count_range(root, from, from + MINUTES_PER_DAY - 1);
+        if (count)
+            printf("%3d%6d", d + 1, count);
+        else
+            printf("%3d%6s", d + 1, "-");
+        if ((offset + d) % 7 == 6 || d == days - 1)
+            putchar('\n');
+        if (count > busiest_count)
+        {
+            busiest = d + 1;
+            busiest_count = count;
+        }
+    }
+    int total = avl_count_range(root, first_day * MINUTES_PER_DAY, (first_day + days) * MINUTES_PER_DAY - 1);
+    if (total)
+        printf("Total: %d appointments, busiest day: %d (%d)\n", total, busiest, busiest_count);
+    else
+        puts("Total: 0 appointments");
+}
+
+// Janji dengan from <= when <= to: seek cursor lalu jalan in-order,
+// O(log n + k). Jumlahnya dihitung dulu dari rank
+static void print_time_range(AVLNode *root, int from, int to)
+{
+    BufferedWriter writer;
+    writer.out = stdout;
+    writer.len = 0;
+
+    char from_date[11], from_time[6], to_date[11], to_time[6];
+    format_when(from, from_date, from_time);
+    format_when(to, to_date, to_time);
+    writer_printf(&writer, "=== Appointments %s %s - %s (%d) ===\n", from_date, from_time, to_time,
+                  avl_count_range(root, from, to));
+
+    AVLCursor cursor;
+    avl_cursor_seek(&cursor, root, from);
+    int rows = 0;
+    for (ReservationNode *res; (res = avl_cursor_peek(&cursor)) && res->when <= to; avl_cursor_next(&cursor))
+    {
+        write_report_row(&writer, res);
+        rows++;
+    }
+    if (rows == 0)
+        writer_printf(&writer, "No appointments in this range.\n");
+    writer_flush(&writer);
+    fflush(stdout);
+}
+
+// Menu kalender admin (s NULL = semua dokter, index by_time di
+// reservation_store) dan dokter (jadwal s): kalender bulan lalu tampilan
+// satu hari, opsional dibatasi jam. Bulan arsip dimuat dulu (lihat
+// admin_menu soal lock)
+void calendar_query(hash_table *ht, DoctorSchedule *s)
+{
+    char text[20];
+    int month;
+    printf("Month (YYYY-MM): ");
+    scanf("%19s", text);
+    getchar();
+    if (!parse_month(text, &month))
+    {
+        puts("Invalid month.");
+        return;
+    }
+    int month_from = month_start(month), month_to = month_start(month + 1) - 1;
+    archive_load_range(ht, month_from, month_to);
+
+    // Isi dari clinic.snap sebelum lock: fill ikut mengambil lock store
+    mutex_t *lock = s ? &s->lock : &reservation_store.lock;
+    if (s)
+        snapshot_fill_schedule(s);
+    else
+        snapshot_fill_schedules();
+
+    int64_t started = metric_start();
+    mutex_lock(lock);
+    print_month_calendar(s ? s->appointments : reservation_store.by_time, month, s ? s->doctor : "all doctors");
+    mutex_unlock(lock);
+    metric_stop(METRIC_RANGE_QUERY, started);
+
+    int days = (month_to + 1 - month_from) / MINUTES_PER_DAY, day;
+    printf("Day to view (1-%d, 0 to skip): ", days);
+    if (scanf("%d", &day) != 1)
+    {
+        while (getchar() != '\n')
+            ;
+        day = 0;
+    }
+    else
+    {
+        getchar();
+    }
+    if (day < 1 || day > days)
+        return;
+
+    char from[20], to[20];
+    int from_minute = 0, to_minute = MINUTES_PER_DAY - 1;
+    printf("From time (HH:MM, - for 00:00): ");
+    scanf("%19s", from);
+    printf("To time (HH:MM, - for 23:59): ");
+    scanf("%19s", to);
+    getchar();
+    if ((strcmp(from, "-") && !parse_time(from, &from_minute)) ||
+        (strcmp(to, "-") && !parse_time(to, &to_minute)))
+    {
+        puts("Invalid time.");
+        return;
+    }
+
+    int day_when = month_from + (day - 1) * MINUTES_PER_DAY;
+    started = metric_start();
+    mutex_lock(lock);
+    print_time_range(s ? s->appointments : reservation_store.by_time, day_when + from_minute, day_when + to_minute);
+    mutex_unlock(lock);
+    metric_stop(METRIC_RANGE_QUERY, started);
+}
+
+static void print_pool_stats(const Pool *pool)
+{
+    printf("%-16s live: %-9lld allocs: %-9lld frees: %-9lld slabs: %d (%.1f KB)\n",
+           pool->name, pool->live, pool->allocs, pool->frees, pool->slab_count,
+           pool->slab_count * (double)POOL_SLAB_BYTES / 1024.0);
+}
+
+// Menampilkan counter alokasi semua pool, scratch arena dan arsip reservasi
+void view_memory_stats(void)
+{
+    puts("=== Memory Stats ===");
+    print_pool_stats(&user_pool);
+    print_pool_stats(&reservation_pool);
+    print_pool_stats(&avl_pool);
+    print_pool_stats(&trie_pool);
+    print_pool_stats(&rating_days_pool);
+    printf("%-16s in use: %zu B  peak: %zu B  allocs: %lld  resets: %lld  blocks: %d\n",
+           scratch_arena.name, scratch_arena.bytes_in_use, scratch_arena.peak_bytes,
+           scratch_arena.allocs, scratch_arena.resets, scratch_arena.block_count);
+
+    long long on_disk = 0;
+    int loaded = 0;
+    for (int i = 0; i < archive.count; i++)
+    {
+        on_disk += archive.months[i].rows;
+        loaded += archive.months[i].loaded;
+    }
+    char cutoff[11] = "-";
+    if (archive.cutoff != INT_MIN)
+        format_month(month_of(archive.cutoff), cutoff);
+    printf("%-16s months: %d  rows: %lld  loaded: %d  resident from: %s\n",
+           "archive", archive.count, on_disk, loaded, cutoff);
+}
+
+// Fungsi untuk menampilkan menu admin
+void admin_menu(hash_table *ht)
+{
+    int choice;
+    do
+    {
+        term_clear();
+        puts("=== ADMIN MENU ===");
+        puts("1. View Users");
+        puts("2. Delete User");
+        puts("3. Generate Report");
+        puts("4. Rating Summary");
+        puts("5. Memory Stats");
+        puts("6. Booking Analytics");
+        puts("7. Latency Metrics");
+        puts("8. Appointment Calendar");
+        puts("0. Logout");
+        printf("Choice: ");
+        if (scanf("%d", &choice) != 1)
+        {
+            while (getchar() != '\n')
+                ;
+            choice = -1;
+        }
+        getchar();
+
+        // Aksi menu memegang table_lock shared supaya thread persistence
+        // tidak membuat snapshot (compaction) di tengah perubahan
+        rwlock_read_lock(&table_lock);
+        switch (choice)
+        {
+        case 1:
+            view_all_users(ht);
+            pause_console();
+            break;
+        case 2:
+        {
+            char uname[20];
+            printf("Enter username to delete: ");
+            scanf("%19s", uname);
+            getchar();
+            delete_user(ht, uname);
+            pause_console();
+            break;
+        }
+        case 3:
+        {
+            char from[20], to[20];
+            int limit, from_day = 0, to_day = 0;
+            printf("Start date (YYYY-MM-DD, - for all): ");
+            scanf("%19s", from);
+            printf("End date (YYYY-MM-DD, - for all): ");
+            scanf("%19s", to);
+            printf("Max rows (0 for all): ");
+            if (scanf("%d", &limit) != 1)
+            {
+                while (getchar() != '\n')
+                    ;
+                limit = 0;
+            }
+            else
+            {
+                getchar();
+            }
+            if ((strcmp(from, "-") && !parse_date(from, &from_day)) ||
+                (strcmp(to, "-") && !parse_date(to, &to_day)))
+            {
+                puts("Invalid date.");
+                pause_console();
+                break;
+            }
+            int from_when = strcmp(from, "-") ? from_day * MINUTES_PER_DAY : INT_MIN;
+            int to_when = strcmp(to, "-") ? (to_day + 1) * MINUTES_PER_DAY - 1 : INT_MAX;
+            // Menu interaktif satu-satunya thread yang mengubah data, jadi
+            // bulan arsip boleh dimuat di bawah lock shared
+            archive_load_range(ht, from_when, to_when);
+            generate_report_with_heap(from_when, to_when, limit, stdout);
+            pause_console();
+            break;
+        }
+        case 4:
+            char prefix[20];
+            printf("Enter doctor name prefix (- for all): ");
+            scanf("%19s", prefix);
+            if (!strcmp(prefix, "-"))
+                prefix[0] = '\0';
+            search_rating_by_prefix(trie_root, prefix);
+            to_lowercase(prefix);
+            print_rating_summary(trie_root, prefix);
+            pause_console();
+            break;
+        case 5:
+            view_memory_stats();
+            pause_console();
+            break;
+        case 6:
+        {
+            char from[20], to[20];
+            int from_day, to_day;
+            printf("Start date (YYYY-MM-DD): ");
+            scanf("%19s", from);
+            printf("End date (YYYY-MM-DD): ");
+            scanf("%19s", to);
+            getchar();
+            if (!parse_date(from, &from_day) || !parse_date(to, &to_day))
+                puts("Invalid date.");
+            else
+            {
+                archive_load_range(ht, from_day * MINUTES_PER_DAY, (to_day + 1) * MINUTES_PER_DAY - 1);
+                booking_analytics(from_day, to_day);
+            }
+            pause_console();
+            break;
+        }
+        case 7:
+            puts("=== Latency Metrics (all threads since start) ===");
+            print_metrics(stdout);
+            pause_console();
+            break;
+        case 8:
+            calendar_query(ht, NULL);
+            pause_console();
+            break;
+        }
+        rwlock_read_unlock(&table_lock);
+    } while (choice != 0);
+}
+
+// ======================= [CLIENT FUNCTIONS] =======================
+
+// Fungsi untuk membuat reservasi
+// User akan memasukkan nama dokter, tanggal, waktu, dan catatan
+// Jika dokter tidak ditemukan atau tidak tersedia, akan menampilkan pesan error
+
+void view_doctors_list(hash_table *ht)
+{
+    puts("=== List of Doctors ===");
+    for (int i = 0; i < ht->capacity; i++)
+    {
+        User *cur = ht->slots[i].user;
+        if (!cur)
+            continue;
+
+        if (cur->role == ROLE_DOCTOR)
+        {
+            printf("Doctor: %s | Available: %s\n", cur->username, cur->available ? "Yes" : "No");
+        }
+    }
+}
+
+void create_reservation(User *u, hash_table *ht)
+{
+    view_doctors_list(ht);
+
+    puts("=== Create Reservation ===");
+
+    char doctor_input[50], date[20], time[10], notes[100];
+    printf("Enter doctor's name: ");
+    scanf(" %49[^\n]", doctor_input);
+
+    User *doctor;
+    int status = find_bookable_doctor(ht, doctor_input, &doctor);
+    if (status != OP_OK)
+    {
+        puts(status == OP_UNAVAILABLE ? "Doctor is currently unavailable." : "Doctor not found.");
+        return;
+    }
+
+    printf("Enter date (YYYY-MM-DD): ");
+    scanf("%19s", date);
+    getchar();
+
+    printf("Enter time (HH:MM): ");
+    scanf("%9s", time);
+    getchar();
+
+    int when;
+    if (!make_when(date, time, &when))
+    {
+        puts("Invalid date or time.");
+        return;
+    }
+    if (archive_is_closed(when))
+    {
+        char month[11];
+        format_month(month_of(archive.cutoff), month);
+        printf("Months before %s are archived. Choose a later date.\n", month);
+        return;
+    }
+
+    // Slot dicek sebelum meminta notes supaya pasien bisa langsung pindah jam
+    DoctorSchedule *schedule = find_doctor_schedule(doctor->username, 0);
+    snapshot_fill_schedule(schedule);
+    if (schedule && slot_is_taken(schedule, when))
+    {
+        int next = next_free_slot(schedule, when);
+        format_when(next, date, time);
+        printf("That slot is already booked. Next free slot: %s %s (%d free that day)\n",
+               date, time, free_slots_on_day(schedule, next / MINUTES_PER_DAY));
+        return;
+    }
+
+    printf("Enter notes: ");
+    scanf(" %99[^\n]", notes);
+
+    status = book_reservation(ht, u, doctor->username, when, notes, NULL);
+    if (status == OP_DUPLICATE)
+        puts("You already have a reservation with this doctor at that time.");
+    else if (status == OP_NO_MEMORY)
+        puts("Memory allocation failed.");
+    else if (status != OP_OK)
+        puts("Reservation could not be created.");
+    else
+        puts("Reservation created successfully!");
+}
+
+// Fungsi untuk menampilkan semua reservasi
+// yang dimiliki oleh user
+void view_reservation(User *u)
+{
+    if (!u->reservations)
+    {
+        puts("No reservations found.");
+        return;
+    }
+
+    puts("=== Your Reservations (Sorted by Date) ===");
+    inorder_traversal_avl(u->reservations, 0, stdout);
 }
 
 // Fungsi untuk membatalkan reservasi
@@ -788,479 +6470,1603 @@ void view_reservation(User *u)
 //  Jika nomor tidak valid, akan menampilkan pesan error
 void cancel_reservation(User *u)
 {
-    if (u->reservations_front == NULL)
+    if (u->reservations == NULL)
+    {
+        puts("No reservations to cancel.");
+        return;
+    }
+
+    puts("=== Your Reservations ===");
+    AVLCursor cursor;
+    avl_cursor_seek(&cursor, u->reservations, INT_MIN);
+    int i = 1;
+    for (ReservationNode *res; (res = avl_cursor_peek(&cursor)); avl_cursor_next(&cursor))
+    {
+        char date[11], time[6];
+        format_when(res->when, date, time);
+        printf("%d. Date: %s, Time: %s, Doctor: %s, Notes: %s\n",
+               i, date, time, doctor_name(res->doctor_id), res->notes);
+        i++;
+    }
+
+    int choice;
+    printf("\nMasukkan Nomor Reservasi yang akan di cancel (0 untuk kembali): ");
+    if (scanf("%d", &choice) != 1)
+    {
+        while (getchar() != '\n')
+            ;
+        puts("Invalid input.");
+        return;
+    }
+    getchar();
+
+    if (choice == 0)
+    {
+        puts("Cancellation aborted.");
+        return;
+    }
+
+    if (choice < 1)
+    {
+        puts("Invalid choice.");
+        return;
+    }
+
+    // Nomor di daftar = urutan in-order, dicari lewat ukuran subtree
+    AVLNode *node = avl_select(u->reservations, choice - 1);
+    if (!node)
+    {
+        puts("Reservation not found.");
+        return;
+    }
+    if (archive_is_closed(node->res->when))
+    {
+        puts("Reservations in archived months cannot be canceled.");
+        return;
+    }
+    cancel_booking(u, node->res);
+    puts("Reservation canceled successfully.");
+}
+
+// Menu riwayat: memuat bulan arsip mulai bulan yang diminta (lihat
+// admin_menu soal lock). Return 0 jika input tidak valid
+int load_history(hash_table *ht)
+{
+    char text[20];
+    int month;
+    printf("Show history from month (YYYY-MM): ");
+    scanf("%19s", text);
+    getchar();
+    if (!parse_month(text, &month))
+    {
+        puts("Invalid month.");
+        return 0;
+    }
+    archive_load_range(ht, month_start(month), INT_MAX);
+    return 1;
+}
+
+// Rate Doctor function
+
+void rate_doctor(User *u, hash_table *ht)
+{
+    char input[50];
+    int rating;
+
+    puts("=== Rate a Doctor ===");
+    printf("Enter doctor's name or prefix: ");
+    scanf(" %[^\n]", input);
+    getchar();
+    to_lowercase(input);
+
+    // Cari di radix tree; node dokter bisa langsung dipakai tanpa lookup hash
+    int exact;
+    User *doctor = NULL;
+    rwlock_read_lock(&trie_lock);
+    TrieNode *node = trie_find_prefix(trie_root, input, &exact);
+    if (node && exact)
+        doctor = node->doctor;
+    else if (node)
+    {
+        // Prefix only – show suggestions and ask again
+        puts("Doctor not found exactly, but here are suggestions:");
+        print_rating_trie(node, TRIE_TOP_K);
+    }
+    rwlock_read_unlock(&trie_lock);
+
+    if (!node)
+    {
+        puts("No doctor found with that prefix.");
+        return;
+    }
+
+    if (!doctor)
+    {
+        char full_name[50];
+        printf("\nEnter full doctor's name: ");
+        scanf(" %[^\n]", full_name);
+        getchar();
+        to_lowercase(full_name);
+
+        rwlock_read_lock(&trie_lock);
+        node = trie_find_prefix(trie_root, full_name, &exact);
+        if (node && exact)
+            doctor = node->doctor;
+        rwlock_read_unlock(&trie_lock);
+        if (!doctor)
+        {
+            puts("Doctor not found.");
+            return;
+        }
+    }
+
+    printf("Enter rating (1-5) for %s: ", doctor->username);
+    if (scanf("%d", &rating) != 1 || rating < 1 || rating > 5)
+    {
+        puts("Invalid rating.");
+        return;
+    }
+    getchar();
+
+    float avg;
+    rate_doctor_by_name(ht, doctor->username, rating, &avg);
+    printf("Thank you! New average for %s: %.2f (%d ratings)\n", doctor->username, avg, doctor->rating_count);
+}
+
+// Fungsi untuk menampilkan daftar dokter
+void client_menu(User *u, hash_table *ht)
+{
+    int choice;
+    do
+    {
+        term_clear();
+        printf("=== CLIENT MENU (User: %s) ===\n", u->username);
+        puts("1. Create Reservation");
+        puts("2. View My Reservations");
+        puts("3. Cancel Reservation");
+        puts("4. Payment");
+        puts("5. Rate Doctor");
+        puts("6. Reservation History");
+        puts("0. Logout");
+        printf("Choice: ");
+        if (scanf("%d", &choice) != 1)
+        {
+            while (getchar() != '\n')
+                ;
+            choice = -1;
+        }
+        getchar();
+
+        rwlock_read_lock(&table_lock); // lihat admin_menu
+        switch (choice)
+        {
+        case 1:
+            create_reservation(u, ht);
+            pause_console();
+            break;
+        case 2:
+            view_reservation(u);
+            pause_console();
+            break;
+        case 3:
+            cancel_reservation(u);
+            pause_console();
+            break;
+        case 4:
+            puts("Payment feature not implemented yet.");
+            pause_console();
+            break;
+        case 5:
+            rate_doctor(u, ht);
+            pause_console();
+            break;
+        case 6:
+            if (load_history(ht))
+                view_reservation(u);
+            pause_console();
+            break;
+        default:
+            puts("Feature not implemented or invalid choice.");
+            pause_console();
+        }
+        rwlock_read_unlock(&table_lock);
+    } while (choice != 0);
+}
+
+// ======================= [DOCTOR FUNCTIONS] =======================
+
+// Untuk liat list appointment Dokter A
+// Langsung in-order walk dari jadwal dokter di doctor_index
+void view_doctor_appointments(const char *doctor_name, FILE *out)
+{
+    DoctorSchedule *s = find_doctor_schedule(doctor_name, 0);
+    snapshot_fill_schedule(s);
+    if (!s || !s->appointments)
     {
-        puts("No reservations to cancel.");
+        fputs("No appointments found.\n", out);
         return;
     }
 
-    puts("=== Your Reservations ===");
-    ReservationNode *res = u->reservations_front;
-    int i = 1;
-    while (res)
+    fputs("=== Appointments (Sorted by Date) ===\n", out);
+    inorder_traversal_avl(s->appointments, 1, out);
+}
+
+// Untuk set dokter available ato engga
+void toggle_availability(User *u)
+{
+    u->available = !u->available;
+    puts(u->available ? "You are now available." : "You are now unavailable.");
+}
+
+// Dokter Menu
+void doctor_menu(User *u, hash_table *ht)
+{
+    int choice;
+    do
     {
-        printf("%d. Date: %s, Time: %s, Doctor: %s, Notes: %s\n",
-               i, res->date, res->time, res->doctor, res->notes);
-        res = res->next;
-        i++;
+        term_clear();
+        printf("=== DOCTOR MENU (User: %s) ===\n", u->username);
+        puts("1. View My Appointments");
+        puts("2. Toggle Availability");
+        puts("3. Appointment History");
+        puts("4. Appointment Calendar");
+        puts("0. Logout");
+        printf("Choice: ");
+        if (scanf("%d", &choice) != 1)
+        {
+            while (getchar() != '\n')
+                ;
+            choice = -1;
+        }
+        getchar();
+
+        rwlock_read_lock(&table_lock); // lihat admin_menu
+        switch (choice)
+        {
+        case 1:
+            view_doctor_appointments(u->username, stdout);
+            pause_console();
+            break;
+        case 2:
+            toggle_availability(u);
+            pause_console();
+            break;
+        case 3:
+            if (load_history(ht))
+                view_doctor_appointments(u->username, stdout);
+            pause_console();
+            break;
+        case 4:
+        {
+            DoctorSchedule *s = find_doctor_schedule(u->username, 0);
+            if (s)
+                calendar_query(ht, s);
+            else
+                puts("No appointments found.");
+            pause_console();
+            break;
+        }
+        }
+        rwlock_read_unlock(&table_lock);
+    } while (choice != 0);
+}
+
+// ======================= [AUTH FUNCTIONS] ========================
+
+// Fungsi untuk login user
+void login(hash_table *ht)
+{
+    char username[20], password[20];
+
+    printf("Username: ");
+    scanf("%19s", username);
+    getchar();
+
+    printf("Password: ");
+    scanf("%19s", password);
+    getchar();
+
+    rwlock_read_lock(&table_lock); // lihat admin_menu
+    User *u = authenticate(ht, username, password);
+    rwlock_read_unlock(&table_lock);
+    if (u)
+    {
+        if (u->role == ROLE_ADMIN)
+        {
+            puts("Login successful as ADMIN.");
+            pause_console();
+            admin_menu(ht);
+        }
+        else if (u->role == ROLE_DOCTOR)
+        {
+            puts("Login successful as DOCTOR.");
+            pause_console();
+            doctor_menu(u, ht);
+        }
+        else
+        {
+            puts("Login successful as CLIENT.");
+            pause_console();
+            client_menu(u, ht);
+        }
+    }
+    else
+    {
+        puts("Invalid username or password.");
+        pause_console();
     }
+}
 
-    int choice;
-    printf("\nMasukkan Nomor Reservasi yang akan di cancel (0 untuk kembali): ");
-    if (scanf("%d", &choice) != 1)
+// Fungsi untuk mendaftarkan user baru sebagai client
+void register_client(hash_table *ht)
+{
+    char username[20], password[20];
+
+    puts("=== Client Registration ===");
+    printf("Choose username: ");
+    scanf("%19s", username);
+    getchar();
+
+    if (find_user(ht, username))
     {
-        while (getchar() != '\n')
-            ;
-        puts("Invalid input.");
+        puts("Username already exists.");
+        pause_console();
         return;
     }
+
+    printf("Choose password: ");
+    scanf("%19s", password);
     getchar();
 
-    if (choice == 0)
+    int status = register_client_account(ht, username, password);
+    if (status == OP_OK)
+        puts("Registration successful!");
+    else
+        puts(status == OP_INVALID ? "Invalid username or password." : "Registration failed.");
+    pause_console();
+}
+
+// ======================= [BATCH MODE] =======================
+// clinic --batch [file.jsonl] [hasil.jsonl]: menjalankan satu operasi per
+// baris JSON lewat [OPERATIONS] tanpa menu, misalnya
+//   {"op":"login","username":"alice","password":"1234"}
+//   {"op":"create","doctor":"drdoom","date":"2025-05-01","time":"10:00","notes":"checkup"}
+// Hasil per baris ditulis sebagai JSONL, ringkasan throughput ke stderr
+
+static const char *json_skip_ws(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')
+        p++;
+    return p;
+}
+
+// p menunjuk ke '"'. Return posisi setelah kutip penutup, NULL jika rusak
+// atau tidak muat di out (tidak dipotong diam-diam)
+static const char *json_parse_string(const char *p, char *out, int cap)
+{
+    int len = 0;
+    for (p++; *p != '"'; p++)
     {
-        puts("Cancellation aborted.");
-        return;
+        char c = *p;
+        if (c == '\0')
+            return NULL;
+        if (c == '\\')
+        {
+            switch (*++p)
+            {
+            case '"':
+            case '\\':
+            case '/':
+                c = *p;
+                break;
+            case 'n':
+                c = '\n';
+                break;
+            case 't':
+                c = '\t';
+                break;
+            case 'r':
+                c = '\r';
+                break;
+            case 'b':
+                c = '\b';
+                break;
+            case 'f':
+                c = '\f';
+                break;
+            case 'u':
+            {
+                // Hanya ASCII yang dipertahankan, sisanya jadi '?'
+                int code = 0;
+                for (int i = 1; i <= 4; i++)
+                {
+                    int h = tolower((unsigned char)p[i]);
+                    if (!isxdigit(h))
+                        return NULL;
+                    code = code * 16 + (isdigit(h) ? h - '0' : h - 'a' + 10);
+                }
+                p += 4;
+                c = code > 0 && code < 128 ? (char)code : '?';
+                break;
+            }
+            default:
+                return NULL;
+            }
+        }
+        if (len + 1 >= cap)
+            return NULL;
+        out[len++] = c;
     }
+    out[len] = '\0';
+    return p + 1;
+}
 
-    if (choice < 1)
+// Angka, true, false atau null disalin sebagai teks
+static const char *json_parse_scalar(const char *p, char *out, int cap)
+{
+    int len = 0;
+    while (*p && *p != ',' && *p != '}' && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
     {
-        puts("Invalid choice.");
-        return;
+        if (*p == '{' || *p == '[' || *p == '"' || len + 1 >= cap)
+            return NULL;
+        out[len++] = *p++;
     }
+    out[len] = '\0';
+    return len ? p : NULL;
+}
 
-    ReservationNode *current = u->reservations_front;
-    ReservationNode *prev = NULL;
-    int count = 1;
+// Parse satu objek JSON datar. Return 0 jika bukan objek valid
+int json_parse_object(const char *line, JsonObject *obj)
+{
+    obj->count = 0;
+    const char *p = json_skip_ws(line);
+    if (*p++ != '{')
+        return 0;
+    p = json_skip_ws(p);
+    if (*p == '}')
+        return *json_skip_ws(p + 1) == '\0';
 
-    while (current && count < choice)
+    for (;;)
     {
-        prev = current;
-        current = current->next;
-        count++;
+        if (obj->count == JSON_MAX_FIELDS || *p != '"')
+            return 0;
+        JsonField *field = &obj->fields[obj->count++];
+        if (!(p = json_parse_string(p, field->key, sizeof(field->key))))
+            return 0;
+        p = json_skip_ws(p);
+        if (*p++ != ':')
+            return 0;
+        p = json_skip_ws(p);
+        p = *p == '"' ? json_parse_string(p, field->value, sizeof(field->value))
+                      : json_parse_scalar(p, field->value, sizeof(field->value));
+        if (!p)
+            return 0;
+        p = json_skip_ws(p);
+        if (*p == '}')
+            return *json_skip_ws(p + 1) == '\0';
+        if (*p++ != ',')
+            return 0;
+        p = json_skip_ws(p);
     }
+}
 
-    if (!current)
+// Value field key, NULL jika tidak ada
+const char *json_get(const JsonObject *obj, const char *key)
+{
+    for (int i = 0; i < obj->count; i++)
     {
-        puts("Reservation not found.");
-        return;
+        if (strcmp(obj->fields[i].key, key) == 0)
+            return obj->fields[i].value;
+    }
+    return NULL;
+}
+
+static void reply_printf(BatchReply *reply, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(reply->buf + reply->len, sizeof(reply->buf) - reply->len, fmt, args);
+    va_end(args);
+    if (n > 0)
+        reply->len += (size_t)n < sizeof(reply->buf) - reply->len ? (size_t)n : sizeof(reply->buf) - reply->len - 1;
+}
+
+// Menambah ,"key":"value" dengan escape JSON
+static void reply_string(BatchReply *reply, const char *key, const char *value)
+{
+    reply_printf(reply, ",\"%s\":\"", key);
+    for (const char *c = value; *c && reply->len + 8 < sizeof(reply->buf); c++)
+    {
+        if (*c == '"' || *c == '\\')
+            reply_printf(reply, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            reply_printf(reply, "\\u%04x", *c);
+        else
+            reply->buf[reply->len++] = *c;
+    }
+    reply_printf(reply, "\"");
+}
+
+static const char *const batch_ops[] = {"register", "login", "logout", "create", "cancel",
+                                        "view", "rate", "report", "delete"};
+#define BATCH_OP_COUNT ((int)(sizeof(batch_ops) / sizeof(batch_ops[0])))
+
+// User sesi dengan role tertentu, NULL jika belum login / role beda
+static User *session_user(BatchSession *session, int role)
+{
+    User *u = session->user_id >= 0 ? user_index.by_id[session->user_id] : NULL;
+    return u && u->role == role ? u : NULL;
+}
+
+// Menjalankan satu baris request. *op diisi index di batch_ops
+// (-1 jika baris rusak / op tidak dikenal). Return OP_*
+int batch_execute(hash_table *ht, BatchSession *session, const char *line, BatchReply *reply, int *op)
+{
+    JsonObject req;
+    const char *name;
+    int64_t started = metric_start();
+    reply->len = 0;
+    reply->buf[0] = '\0';
+    *op = -1;
+
+    if (!json_parse_object(line, &req) || !(name = json_get(&req, "op")))
+    {
+        reply_printf(reply, "\"status\":\"%s\",\"error\":\"malformed request\"", op_status_name(OP_INVALID));
+        return OP_INVALID;
+    }
+    for (int i = 0; i < BATCH_OP_COUNT; i++)
+    {
+        if (strcmp(name, batch_ops[i]) == 0)
+            *op = i;
+    }
+    if (*op < 0)
+    {
+        reply_printf(reply, "\"status\":\"%s\"", op_status_name(OP_INVALID));
+        reply_string(reply, "error", "unknown op");
+        return OP_INVALID;
     }
 
-    // Remove current node
-    if (prev == NULL)
-    { // hapus node depan
-        u->reservations_front = current->next;
-        if (u->reservations_front == NULL)
+    const char *username = json_get(&req, "username");
+    const char *password = json_get(&req, "password");
+    const char *doctor = json_get(&req, "doctor");
+    const char *date = json_get(&req, "date");
+    const char *time = json_get(&req, "time");
+    char extra[64] = "";
+    int status = OP_INVALID;
+    int when;
+
+    // register & delete mengubah struktur hash table, report yang mencakup
+    // bulan arsip memuat segment-nya; sisanya cukup shared
+    const char *from = json_get(&req, "from");
+    int from_day = 0;
+    int exclusive = *op == 0 || *op == 8 ||
+                    (*op == 7 && (!from || (parse_date(from, &from_day) && archive_is_closed(from_day * MINUTES_PER_DAY))));
+    if (exclusive)
+        rwlock_write_lock(&table_lock);
+    else
+        rwlock_read_lock(&table_lock);
+
+    switch (*op)
+    {
+    case 0: // register
+        if (username && password)
+            status = register_client_account(ht, username, password);
+        break;
+    case 1: // login
+    {
+        User *u = username && password ? authenticate(ht, username, password) : NULL;
+        status = u ? OP_OK : OP_NOT_FOUND;
+        session->user_id = u ? u->id : -1;
+        if (u)
+            sprintf(extra, ",\"role\":\"%s\"", u->role == ROLE_ADMIN ? "admin" : u->role == ROLE_DOCTOR ? "doctor"
+                                                                                                         : "client");
+        break;
+    }
+    case 2: // logout
+        session->user_id = -1;
+        status = OP_OK;
+        break;
+    case 3: // create
+    case 4: // cancel
+    {
+        User *u = session_user(session, ROLE_CLIENT);
+        if (!u)
+            status = OP_FORBIDDEN;
+        else if (!doctor || !date || !time || !make_when(date, time, &when))
+            status = OP_INVALID;
+        else if (*op == 4)
+            status = cancel_reservation_at(u, when, doctor);
+        else
         {
-            u->reservations_rear = NULL;
+            const char *notes = json_get(&req, "notes");
+            int next_free;
+            status = book_reservation(ht, u, doctor, when, notes ? notes : "", &next_free);
+            if (status == OP_SLOT_TAKEN)
+            {
+                char next_date[11], next_time[6];
+                format_when(next_free, next_date, next_time);
+                sprintf(extra, ",\"next_free\":\"%s %s\"", next_date, next_time);
+            }
         }
+        break;
     }
-    else
+    case 5: // view
+    {
+        User *u = session_user(session, ROLE_CLIENT);
+        status = u ? OP_OK : OP_FORBIDDEN;
+        if (u)
+            sprintf(extra, ",\"count\":%d", count_reservations(u));
+        break;
+    }
+    case 6: // rate
+    {
+        const char *rating = json_get(&req, "rating");
+        float average;
+        if (!session_user(session, ROLE_CLIENT))
+            status = OP_FORBIDDEN;
+        else if (doctor && rating)
+            status = rate_doctor_by_name(ht, doctor, atoi(rating), &average);
+        if (status == OP_OK)
+            sprintf(extra, ",\"average\":%.2f", average);
+        break;
+    }
+    case 7: // report
     {
-        prev->next = current->next;
-        if (current == u->reservations_rear)
+        const char *to = json_get(&req, "to");
+        const char *limit = json_get(&req, "limit");
+        int to_day = 0;
+        if (!session_user(session, ROLE_ADMIN))
+            status = OP_FORBIDDEN;
+        else if ((!from || parse_date(from, &from_day)) && (!to || parse_date(to, &to_day)))
         {
-            u->reservations_rear = prev;
+            int from_when = from ? from_day * MINUTES_PER_DAY : INT_MIN;
+            int to_when = to ? (to_day + 1) * MINUTES_PER_DAY - 1 : INT_MAX;
+            if (exclusive)
+                archive_load_range(ht, from_when, to_when);
+            int rows = generate_report_with_heap(from_when, to_when, limit ? atoi(limit) : 0, NULL);
+            sprintf(extra, ",\"rows\":%d", rows);
+            status = OP_OK;
         }
+        break;
+    }
+    case 8: // delete
+        if (!session_user(session, ROLE_ADMIN))
+            status = OP_FORBIDDEN;
+        else if (username)
+            status = delete_user_account(ht, username);
+        break;
     }
 
-    free(current);
-    puts("Reservation canceled successfully.");
-}
+    if (exclusive)
+        rwlock_write_unlock(&table_lock);
+    else
+        rwlock_read_unlock(&table_lock);
 
-// Rate Doctor function
+    reply_printf(reply, "\"status\":\"%s\"", op_status_name(status));
+    reply_string(reply, "op", name);
+    reply_printf(reply, "%s", extra);
+    metric_stop(METRIC_REQUEST + *op, started);
+    return status;
+}
 
-void save_rating_to_csv(const char *filename, const char *doctor_name, int rating)
+int run_batch(hash_table *ht, const char *path, const char *out_path)
 {
-    FILE *file = fopen(filename, "a"); // append mode
-    if (!file)
+    FILE *in = fopen(path, "r");
+    if (!in)
     {
-        puts("Failed to save rating.");
-        return;
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out)
+    {
+        fprintf(stderr, "Cannot open %s\n", out_path);
+        fclose(in);
+        return 1;
     }
 
-    fprintf(file, "%s,%d\n", doctor_name, rating);
-    fclose(file);
+    BufferedWriter writer;
+    writer.out = out;
+    writer.len = 0;
+
+    BatchSession session;
+    session.user_id = -1;
+    BatchReply reply;
+    int ok[BATCH_OP_COUNT] = {0}, failed[BATCH_OP_COUNT] = {0};
+    int lines = 0, malformed = 0;
+    char line[BATCH_LINE_BYTES];
+
+    double start = now_ms();
+    while (fgets(line, sizeof(line), in))
+    {
+        lines++;
+        int op, status;
+        size_t len = strlen(line);
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n')
+        {
+            // Baris terlalu panjang: buang sisanya dan laporkan sebagai rusak
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n')
+                ;
+            reply.len = 0;
+            reply_printf(&reply, "\"status\":\"%s\",\"error\":\"line too long\"", op_status_name(OP_INVALID));
+            op = -1;
+            status = OP_INVALID;
+        }
+        else
+        {
+            if (*json_skip_ws(line) == '\0')
+                continue; // baris kosong tidak dihitung
+            status = batch_execute(ht, &session, line, &reply, &op);
+        }
+
+        if (op < 0)
+            malformed++;
+        else if (status == OP_OK)
+            ok[op]++;
+        else
+            failed[op]++;
+        writer_printf(&writer, "{\"line\":%d,%s}\n", lines, reply.buf);
+    }
+    double elapsed = now_ms() - start;
+    writer_flush(&writer);
+    fclose(in);
+    if (out != stdout)
+        fclose(out);
+
+    int total = malformed;
+    fprintf(stderr, "=== Batch Summary (%s) ===\n", path);
+    fprintf(stderr, "%-10s %8s %8s\n", "op", "ok", "failed");
+    for (int i = 0; i < BATCH_OP_COUNT; i++)
+    {
+        total += ok[i] + failed[i];
+        if (ok[i] || failed[i])
+            fprintf(stderr, "%-10s %8d %8d\n", batch_ops[i], ok[i], failed[i]);
+    }
+    if (malformed)
+        fprintf(stderr, "%-10s %8s %8d\n", "malformed", "-", malformed);
+    fprintf(stderr, "Total: %d requests in %.2f ms (%.0f req/s)\n",
+            total, elapsed, elapsed > 0 ? total * 1000.0 / elapsed : 0.0);
+    return 0;
 }
 
-void rate_doctor(User *u, hash_table *ht)
+// ======================= [SERVER MODE] =======================
+// clinic --serve [port] [workers]: protokol sama dengan batch mode (satu
+// request JSON per baris, satu balasan JSON per baris) lewat TCP lokal.
+// Thread utama hanya accept; setiap koneksi dilayani satu worker dari
+// pool sampai ditutup, dengan sesi login sendiri
+
+typedef struct
 {
-    char input[50];
-    int rating;
+    hash_table *ht;
+    socket_t queue[SERVER_QUEUE_SIZE];
+    int head;
+    int count;
+    mutex_t lock;
+    cond_t not_empty;
+} ConnectionQueue;
+
+static socket_t next_connection(ConnectionQueue *q)
+{
+    mutex_lock(&q->lock);
+    while (q->count == 0)
+        cond_wait(&q->not_empty, &q->lock);
+    socket_t s = q->queue[q->head];
+    q->head = (q->head + 1) % SERVER_QUEUE_SIZE;
+    q->count--;
+    mutex_unlock(&q->lock);
+    return s;
+}
 
-    puts("=== Rate a Doctor ===");
-    printf("Enter doctor's name or prefix: ");
-    scanf(" %[^\n]", input);
-    getchar();
-    to_lowercase(input);
+static void serve_connection(hash_table *ht, socket_t s)
+{
+    BatchSession session;
+    session.user_id = -1;
+    BatchReply reply;
+    char buf[BATCH_LINE_BYTES];
+    char out[sizeof(reply.buf) + 32];
+    int len = 0, lines = 0, overflow = 0;
+
+    for (;;)
+    {
+        int n = net_recv(s, buf + len, (int)sizeof(buf) - 1 - len);
+        if (n <= 0)
+            break;
+        len += n;
+
+        int start = 0;
+        for (int i = start; i < len; i++)
+        {
+            if (buf[i] != '\n')
+                continue;
+            buf[i] = '\0';
+            if (overflow)
+            {
+                overflow = 0; // akhir baris yang terlalu panjang
+                start = i + 1;
+                continue;
+            }
+
+            int op;
+            if (*json_skip_ws(buf + start))
+            {
+                batch_execute(ht, &session, buf + start, &reply, &op);
+                int out_len = snprintf(out, sizeof(out), "{\"line\":%d,%s}\n", ++lines, reply.buf);
+                if (!net_send_all(s, out, out_len < (int)sizeof(out) ? out_len : (int)sizeof(out) - 1))
+                {
+                    net_close(s);
+                    return;
+                }
+            }
+            start = i + 1;
+        }
+
+        memmove(buf, buf + start, len - start);
+        len -= start;
+        if (len == (int)sizeof(buf) - 1)
+        {
+            // Baris tidak muat di buffer: tolak lalu buang sampai newline
+            int out_len = snprintf(out, sizeof(out), "{\"line\":%d,\"status\":\"%s\",\"error\":\"line too long\"}\n",
+                                   ++lines, op_status_name(OP_INVALID));
+            net_send_all(s, out, out_len);
+            overflow = 1;
+            len = 0;
+        }
+    }
+    net_close(s);
+}
+
+// Diset oleh Ctrl+C / SIGTERM; listener ditutup supaya accept berhenti
+static volatile int server_stop = 0;
+static socket_t server_listener = NET_INVALID;
+
+#ifdef _WIN32
+static BOOL WINAPI on_server_stop(DWORD type)
+{
+    (void)type;
+    server_stop = 1;
+    closesocket(server_listener);
+    return TRUE;
+}
+#else
+static void on_server_stop(int sig)
+{
+    (void)sig;
+    server_stop = 1;
+}
+#endif
+
+static void *server_worker(void *arg)
+{
+    ConnectionQueue *q = (ConnectionQueue *)arg;
+    for (;;)
+        serve_connection(q->ht, next_connection(q));
+    return NULL;
+}
 
-    // Traverse Trie
-    TrieNode *cur = trie_root;
-    for (int i = 0; input[i]; i++)
+// Semua dokter di-intern dulu supaya doctor_index (dan by_id) tidak
+// berubah lagi selama worker berjalan tanpa lock. clinic.snap dilepas:
+// materialize lazy tidak aman untuk worker yang memegang table_lock shared
+static void server_prepare(hash_table *ht)
+{
+    snapshot_release(ht);
+    for (int i = 0; i < ht->capacity; i++)
     {
-        int idx = input[i] - 'a';
-        if (idx < 0 || idx >= ALPHABET_SIZE || !cur->children[idx])
-        {
-            puts("No doctor found with that prefix.");
-            return;
-        }
-        cur = cur->children[idx];
+        User *u = ht->slots[i].user;
+        if (u && u->role == ROLE_DOCTOR)
+            intern_doctor(u->username);
     }
+}
+
+int run_server(hash_table *ht, int port, int workers)
+{
+    if (port <= 0)
+        port = SERVER_DEFAULT_PORT;
+    if (workers <= 0)
+        workers = cpu_count();
 
-    // Exact match? Go ahead and rate
-    if (cur->is_end_of_word)
+    socket_t listener = net_listen(port);
+    if (listener == NET_INVALID)
     {
-        User *doctor = find_user(ht, cur->username);
-        if (!doctor || doctor->role != ROLE_DOCTOR)
-        {
-            puts("Doctor not found.");
-            return;
-        }
+        fprintf(stderr, "Cannot listen on port %d\n", port);
+        return 1;
+    }
+    server_prepare(ht);
 
-        printf("Enter rating (1-5) for %s: ", doctor->username);
-        if (scanf("%d", &rating) != 1 || rating < 1 || rating > 5)
+    static ConnectionQueue q;
+    q.ht = ht;
+    q.head = q.count = 0;
+    mutex_init(&q.lock);
+    cond_init(&q.not_empty);
+
+    for (int i = 0; i < workers; i++)
+    {
+        thread_t t;
+        if (!thread_start(&t, server_worker, &q))
         {
-            puts("Invalid rating.");
-            return;
+            fprintf(stderr, "Cannot start worker %d\n", i);
+            return 1;
         }
-        getchar();
-
-        doctor->total_rating += rating;
-        doctor->rating_count++;
-        save_rating_to_csv("ratings.csv", doctor->username, rating);
-
-        float avg = (float)doctor->total_rating / doctor->rating_count;
-        printf("Thank you! New average for %s: %.2f (%d ratings)\n", doctor->username, avg, doctor->rating_count);
     }
-    else
+    server_listener = listener;
+#ifdef _WIN32
+    SetConsoleCtrlHandler(on_server_stop, TRUE);
+#else
+    struct sigaction stop_action;
+    memset(&stop_action, 0, sizeof(stop_action));
+    stop_action.sa_handler = on_server_stop; // tanpa SA_RESTART: accept kembali dengan EINTR
+    sigaction(SIGINT, &stop_action, NULL);
+    sigaction(SIGTERM, &stop_action, NULL);
+#endif
+    fprintf(stderr, "Listening on 127.0.0.1:%d with %d workers\n", port, workers);
+
+    while (!server_stop)
     {
-        // Prefix only – show suggestions and ask again
-        puts("Doctor not found exactly, but here are suggestions:");
-        print_rating_trie(cur, ht);
-
-        char full_name[50];
-        printf("\nEnter full doctor's name: ");
-        scanf(" %[^\n]", full_name);
-        getchar();
-        to_lowercase(full_name);
+        socket_t s = net_accept(listener);
+        if (s == NET_INVALID)
+            continue;
 
-        User *doctor = find_user(ht, full_name);
-        if (!doctor || doctor->role != ROLE_DOCTOR)
+        mutex_lock(&q.lock);
+        int full = q.count == SERVER_QUEUE_SIZE;
+        if (!full)
         {
-            puts("Doctor not found.");
-            return;
+            q.queue[(q.head + q.count) % SERVER_QUEUE_SIZE] = s;
+            q.count++;
+            cond_signal(&q.not_empty);
         }
+        mutex_unlock(&q.lock);
 
-        printf("Enter rating (1-5): ");
-        if (scanf("%d", &rating) != 1 || rating < 1 || rating > 5)
+        if (full)
         {
-            puts("Invalid rating.");
-            return;
+            static const char busy[] = "{\"status\":\"busy\"}\n";
+            net_send_all(s, busy, (int)sizeof(busy) - 1);
+            net_close(s);
         }
-        getchar();
-
-        doctor->total_rating += rating;
-        doctor->rating_count++;
-        save_rating_to_csv("ratings.csv", doctor->username, rating);
-
-        float avg = (float)doctor->total_rating / doctor->rating_count;
-        printf("Thank you! New average for %s: %.2f (%d ratings)\n", doctor->username, avg, doctor->rating_count);
     }
+
+    // table_lock exclusive menunggu request yang sedang berjalan selesai dan
+    // tidak dilepas lagi, jadi ring persistence bisa dikosongkan dengan aman
+    rwlock_write_lock(&table_lock);
+    persistence_stop();
+    fprintf(stderr, "Server stopped\n");
+    return 0;
 }
 
-void load_ratings_from_csv(hash_table *ht, const char *filename)
+// ======================= [BENCHMARK] =======================
+
+// Mengisi satu AVL dengan n reservasi pada tanggal yang sama lalu
+// mencatat height akhirnya. dup != 0 berarti semua key identik
+static void bench_avl_case(const char *label, int n, int dup)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
-        return; // First time run
+    ReservationNode **items = (ReservationNode **)malloc(n * sizeof(ReservationNode *));
+    if (!items)
+        return;
 
-    char doctor_name[50];
-    int rating;
+    int day = days_from_civil(2025, 1, 6) * MINUTES_PER_DAY;
 
-    while (fscanf(file, "%49[^,],%d\n", doctor_name, &rating) == 2)
+    AVLNode *root = NULL;
+    int count = 0;
+    double start = now_ms();
+    for (int i = 0; i < n; i++)
     {
-        to_lowercase(doctor_name);
-        User *doctor = find_user(ht, doctor_name);
-        if (doctor && doctor->role == ROLE_DOCTOR)
-        {
-            doctor->total_rating += rating;
-            doctor->rating_count++;
-        }
+        ReservationNode *res = (ReservationNode *)pool_alloc(&reservation_pool);
+        if (!res)
+            break;
+        // 96 slot 15 menit per hari, dokter bergantian
+        res->when = day + (dup ? 0 : (i % 96) * 15);
+        res->doctor_id = dup ? 0 : i / 96 % 50;
+        res->patient_id = dup ? 0 : i;
+        res->snapshot_row = -1;
+        res->notes[0] = '\0';
+
+        int inserted;
+        root = insert_avl(root, res, AVL_ALLOW_DUPLICATES, &inserted);
+        items[count++] = res;
+        if (!inserted)
+            break;
     }
+    double elapsed = now_ms() - start;
+    AVL_CHECK(root);
+
+    // Batas height AVL: 1.44 * log2(n + 2) - 0.328
+    double bound = 1.4405 * log2((double)count + 2) - 0.3277;
+    printf("%-18s n=%-9d height=%-3d bound=%-6.1f %8.1f ms  %6.0f ns/insert  %s\n",
+           label, count, height(root), bound, elapsed,
+           count ? elapsed * 1e6 / count : 0.0, height(root) <= bound ? "OK" : "FAIL");
+
+    free_avl(root);
+    for (int i = 0; i < count; i++)
+        pool_free(&reservation_pool, items[i]);
+    free(items);
+}
 
-    fclose(file);
+// clinic --bench-avl [n]: depth AVL untuk insert di hari yang sama
+int run_avl_benchmark(int n)
+{
+    if (n <= 0)
+        n = 100000;
+    puts("=== AVL same-date insert benchmark ===");
+    for (int size = 1000; size < n; size *= 10)
+        bench_avl_case("same date", size, 0);
+    bench_avl_case("same date", n, 0);
+    bench_avl_case("identical key", n, 1);
+    return 0;
 }
 
-// Fungsi untuk menampilkan daftar dokter
-void client_menu(User *u, hash_table *ht)
+// Satu putaran parse seluruh buffer reservasi; mode 0 = sscanf per baris
+// (cara lama: fgets + scanset), 1 = tokenizer. Return jumlah baris valid
+static int bench_csv_pass(const char *data, size_t size, int mode)
 {
-    int choice;
-    do
+    const char *p = data, *end = data + size;
+    int ok = 0;
+    while (p < end)
     {
-        system("cls");
-        printf("=== CLIENT MENU (User: %s) ===\n", u->username);
-        puts("1. Create Reservation");
-        puts("2. View My Reservations");
-        puts("3. Cancel Reservation");
-        puts("4. Payment");
-        puts("5. Rate Doctor");
-        puts("0. Logout");
-        printf("Choice: ");
-        if (scanf("%d", &choice) != 1)
+        const char *next;
+        const char *eol = line_end(p, end, &next);
+        char username[20], date[20], time[10], doctor[50], notes[100];
+        if (mode == 0)
         {
-            while (getchar() != '\n')
-                ;
-            choice = -1;
+            char line[400];
+            size_t len = (size_t)(eol - p) < sizeof(line) - 1 ? (size_t)(eol - p) : sizeof(line) - 1;
+            memcpy(line, p, len);
+            line[len] = '\0';
+            ok += sscanf(line, "%19[^,],%19[^,],%9[^,],%49[^,],%99[^\n]", username, date, time, doctor, notes) == 5;
         }
-        getchar();
-
-        switch (choice)
+        else
         {
-        case 1:
-            create_reservation(u, ht);
-            pause_console();
-            break;
-        case 2:
-            view_reservation(u);
-            pause_console();
-            break;
-        case 3:
-            cancel_reservation(u);
-            pause_console();
-            break;
-        case 4:
-            puts("Payment feature not implemented yet.");
-            pause_console();
-            break;
-        case 5:
-            rate_doctor(u, ht);
-            pause_console();
-            break;
-        default:
-            puts("Feature not implemented or invalid choice.");
-            pause_console();
+            CsvField f[5];
+            if (csv_split(p, eol, f, 5) == 5 && csv_copy(&f[0], username, sizeof(username)) &&
+                csv_copy(&f[1], date, sizeof(date)) && csv_copy(&f[2], time, sizeof(time)) &&
+                csv_copy(&f[3], doctor, sizeof(doctor)))
+            {
+                csv_copy_text(&f[4], notes, sizeof(notes));
+                ok++;
+            }
         }
-    } while (choice != 0);
+        p = next;
+    }
+    return ok;
 }
 
-// ======================= [DOCTOR FUNCTIONS] =======================
-
-// Untuk liat list appointment Dokter A
-void view_doctor_appointments(hash_table *ht, const char *doctor_name)
+// clinic --bench-csv [rows]: parse reservasi sintetis (notes ber-quote
+// berisi koma) dengan sscanf, tokenizer scalar dan tokenizer SIMD
+int run_csv_benchmark(int rows)
 {
-    AVLNode *root = NULL;
-
-    for (int i = 0; i < TABLE_SIZE; i++)
+    if (rows <= 0)
+        rows = 500000;
+    size_t cap = (size_t)rows * 96 + 1;
+    char *data = (char *)malloc(cap);
+    if (!data)
+        return 1;
+    size_t size = 0;
+    for (int i = 0; i < rows; i++)
+        size += snprintf(data + size, cap - size, "patient%d,2025-%02d-%02d,%02d:%02d,doctor%d,\"note %d, follow-up \"\"kontrol\"\"\"\n",
+                         i, i % 12 + 1, i % 28 + 1, i % 24, i % 4 * 15, i % 50, i);
+
+    const char *names[] = {"sscanf", "tokenizer (scalar)", "tokenizer (SIMD)"};
+    printf("=== CSV parse benchmark: %d rows, %.1f MB ===\n", rows, size / 1048576.0);
+    for (int mode = 0; mode < 3; mode++)
     {
-        User *u = ht->table[i];
-        while (u)
+        csv_find_delim = mode == 1 ? csv_find_delim_scalar : csv_find_delim_simd;
+        double best = 0;
+        int ok = 0;
+        for (int run = 0; run < 3; run++)
         {
-            ReservationNode *res = u->reservations_front;
-            while (res)
-            {
-                if (strcmp(res->doctor, doctor_name) == 0)
-                {
-                    // Patient name is already filled when created
-                    root = insert_avl(root, res);
-                }
-                res = res->next;
-            }
-            u = u->next;
+            double start = now_ms();
+            ok = bench_csv_pass(data, size, mode == 0 ? 0 : 1);
+            double elapsed = now_ms() - start;
+            if (run == 0 || elapsed < best)
+                best = elapsed;
         }
+        printf("%-20s %8.2f ms  %8.1f MB/s  %d rows ok\n", names[mode], best, size / 1048576.0 / (best / 1000.0), ok);
     }
+    csv_find_delim = csv_find_delim_simd;
+    free(data);
+    return 0;
+}
 
-    if (!root)
-    {
-        puts("No appointments found.");
-        return;
-    }
-
-    puts("=== Appointments (Sorted by Date) ===");
-    inorder_traversal_avl(root, 1);
+// PRNG xorshift64* untuk data sintetis, deterministik per seed
+static uint64_t bench_rand(uint64_t *state)
+{
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
 }
 
-// Untuk set dokter available ato engga
-void toggle_availability(User *u)
+static int bench_rand_below(uint64_t *state, int n)
 {
-    u->available = !u->available;
-    puts(u->available ? "You are now available." : "You are now unavailable.");
+    return (int)(bench_rand(state) % (uint64_t)n);
 }
 
-// Dokter Menu
-void doctor_menu(User *u, hash_table *ht)
+// Index berdistribusi Zipf lewat binary search di cdf kumulatif
+static int bench_zipf(uint64_t *state, const double *cdf, int n)
 {
-    int choice;
-    do
+    double u = (double)(bench_rand(state) >> 11) / 9007199254740992.0; // [0, 1)
+    int lo = 0, hi = n - 1;
+    while (lo < hi)
     {
-        system("cls");
-        printf("=== DOCTOR MENU (User: %s) ===\n", u->username);
-        puts("1. View My Appointments");
-        puts("2. Toggle Availability");
-        puts("0. Logout");
-        printf("Choice: ");
-        if (scanf("%d", &choice) != 1)
-        {
-            while (getchar() != '\n')
-                ;
-            choice = -1;
-        }
-        getchar();
-
-        switch (choice)
-        {
-        case 1:
-            view_doctor_appointments(ht, u->username);
-            pause_console();
-            break;
-        case 2:
-            toggle_availability(u);
-            pause_console();
-            break;
-        }
-    } while (choice != 0);
+        int mid = lo + (hi - lo) / 2;
+        if (cdf[mid] <= u)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
 }
 
-// ======================= [AUTH FUNCTIONS] ========================
-
-// Fungsi untuk membaca data user dari file CSV
-void load_users_from_csv(hash_table *ht, const char *filename)
+// Membuat users.csv, reservations.csv dan ratings.csv sintetis di dir.
+// Pasien dipilih merata, dokter ber-Zipf (dr0 paling laris) untuk
+// reservasi maupun rating. Reservasi hanya di jam praktik dan tidak
+// double booking; dokter yang kalendernya penuh dilimpahkan ke dokter
+// acak lain. Rating diberi waktu di GEN_RATING_DAYS hari terakhir dan
+// ditulis urut waktu seperti log asli. File turunan lama (journal, agregat rating, clinic.snap)
+// dihapus. Return 0 jika gagal
+int generate_bench_data(const char *dir, int users, int reservations, int ratings, unsigned int seed)
 {
-    FILE *file = fopen(filename, "r");
-    if (!file)
+    if (users <= 0)
+        users = 10000;
+    if (reservations < 0)
+        reservations = users * 2;
+    if (ratings < 0)
+        ratings = users / 2;
+    int doctors = users / GEN_USERS_PER_DOCTOR;
+    if (doctors < 10)
+        doctors = 10;
+    if (doctors > GEN_MAX_DOCTORS)
+        doctors = GEN_MAX_DOCTORS;
+    int clients = users - doctors;
+    if (clients < 1)
     {
-        puts("No user data found. Starting fresh.");
-        return;
+        puts("Need more users than doctors.");
+        return 0;
     }
 
-    char line[100];
-    while (fgets(line, sizeof(line), file))
+    // Kalender cukup panjang supaya terisi paling banyak setengahnya
+    int slots_per_day = CLINIC_OPEN_HOURS * 60 / SLOT_MINUTES;
+    int days = 365;
+    while ((long long)days * slots_per_day * doctors < 2LL * reservations)
+        days *= 2;
+    int capacity = days * slots_per_day;
+    int first_day = month_start(month_of(current_when())) / MINUTES_PER_DAY; // semuanya resident
+
+    double *cdf = (double *)malloc(doctors * sizeof(double));
+    int *booked = (int *)calloc(doctors, sizeof(int));
+    uint64_t *taken = (uint64_t *)calloc(((size_t)doctors * capacity + 63) / 64, sizeof(uint64_t));
+    uint64_t *rated = (uint64_t *)malloc((ratings > 0 ? ratings : 1) * sizeof(uint64_t));
+    if (!cdf || !booked || !taken || !rated)
     {
-        char username[20], password[20];
-        int role;
-
-        // Parse CSV line
-        if (sscanf(line, "%19[^,],%19[^,],%d", username, password, &role) == 3)
-        {
-            // Convert username to lowercase
-            char lowered[20];
-            strncpy(lowered, username, sizeof(lowered));
-            lowered[sizeof(lowered) - 1] = '\0';
-            to_lowercase(lowered);
+        free(cdf);
+        free(booked);
+        free(taken);
+        free(rated);
+        puts("Out of memory.");
+        return 0;
+    }
+    double sum = 0;
+    for (int d = 0; d < doctors; d++)
+        cdf[d] = sum += 1.0 / pow(d + 1, GEN_ZIPF_EXPONENT);
+    for (int d = 0; d < doctors; d++)
+        cdf[d] /= sum;
 
-            // Insert into both hash table and Trie
-            insert_user(ht, lowered, password, role);
-            if (role == ROLE_DOCTOR)
-            {
-                insert_trie(trie_root, lowered);
-            }
-        }
+    if (!make_dir(dir))
+    {
+        printf("Cannot create directory %s.\n", dir);
+        free(cdf);
+        free(booked);
+        free(taken);
+        free(rated);
+        return 0;
+    }
+    char path[260];
+    const char *derived[] = {"reservations.log", "rating_totals.csv", SNAPSHOT_PATH};
+    for (int i = 0; i < 3; i++)
+    {
+        snprintf(path, sizeof(path), "%s/%s", dir, derived[i]);
+        remove(path);
     }
 
-    fclose(file);
-}
-// Fungsi untuk menyimpan data user ke file CSV
-void save_user_to_csv(const char *filename, const char *username, const char *password, int role)
-{
-    FILE *file = fopen(filename, "a"); // Append mode
-    if (!file)
+    double start = now_ms();
+    uint64_t rng = 0x9E3779B97F4A7C15ULL ^ seed;
+    int ok = 1;
+
+    snprintf(path, sizeof(path), "%s/users.csv", dir);
+    FILE *file = fopen(path, "w");
+    ok = ok && file;
+    for (int d = 0; file && d < doctors; d++)
+        fprintf(file, "dr%d,pw,%d\n", d, ROLE_DOCTOR);
+    for (int c = 0; file && c < clients; c++)
+        fprintf(file, "patient%d,pw,%d\n", c, ROLE_CLIENT);
+    if (file && (ferror(file) | fclose(file)))
+        ok = 0;
+
+    snprintf(path, sizeof(path), "%s/reservations.csv", dir);
+    file = ok ? fopen(path, "w") : NULL;
+    ok = ok && file;
+    if (file)
+        fprintf(file, "username,date,time,doctor,notes\n");
+    for (int i = 0; file && i < reservations; i++)
     {
-        puts("Failed to open user CSV for writing.");
-        return;
+        int d = bench_zipf(&rng, cdf, doctors);
+        while (booked[d] == capacity)
+            d = bench_rand_below(&rng, doctors);
+        size_t base = (size_t)d * capacity;
+        int cell = bench_rand_below(&rng, capacity);
+        while (taken[(base + cell) / 64] >> ((base + cell) % 64) & 1)
+            cell = cell + 1 == capacity ? 0 : cell + 1;
+        taken[(base + cell) / 64] |= 1ULL << ((base + cell) % 64);
+        booked[d]++;
+
+        int when = (first_day + cell / slots_per_day) * MINUTES_PER_DAY + 8 * 60 + cell % slots_per_day * SLOT_MINUTES;
+        char date[11], time[6], notes[40], quoted[90];
+        format_when(when, date, time);
+        if (i % 4 == 0)
+            sprintf(notes, "kontrol %d, \"lanjutan\"", i);
+        else
+            sprintf(notes, "keluhan %d", i);
+        fprintf(file, "patient%d,%s,%s,dr%d,%s\n", bench_rand_below(&rng, clients), date, time, d,
+                csv_quote(notes, quoted, sizeof(quoted)));
     }
+    if (file && (ferror(file) | fclose(file)))
+        ok = 0;
+
+    // Setiap dokter punya kualitas 1-5, rating tersebar di sekitarnya.
+    // Waktu diurutkan dulu supaya seq naik bersama waktu (rating_bucket
+    // membuang hari yang lebih lama dari isi bucket)
+    int now = current_when();
+    for (int i = 0; i < ratings; i++)
+        rated[i] = (uint64_t)(now - bench_rand_below(&rng, GEN_RATING_DAYS * MINUTES_PER_DAY));
+    qsort(rated, ratings, sizeof(uint64_t), compare_u64);
+    snprintf(path, sizeof(path), "%s/ratings.csv", dir);
+    file = ok ? fopen(path, "w") : NULL;
+    ok = ok && file;
+    for (int i = 0; file && i < ratings; i++)
+    {
+        int d = bench_zipf(&rng, cdf, doctors);
+        int rating = (int)(((unsigned int)d * 2654435761u) >> 16) % 5 + 1 + bench_rand_below(&rng, 3) - 1;
+        rating = rating < 1 ? 1 : rating > 5 ? 5 : rating;
+        fprintf(file, "%d,dr%d,%d,%d\n", i + 1, d, rating, (int)rated[i]);
+    }
+    if (file && (ferror(file) | fclose(file)))
+        ok = 0;
 
-    fprintf(file, "%s,%s,%d\n", username, password, role);
-    fclose(file);
+    if (ok)
+        printf("Generated %d users (%d doctors), %d reservations over %d days, %d ratings in %s (%.0f ms)\n",
+               users, doctors, reservations, days, ratings, dir, now_ms() - start);
+    else
+        printf("Failed to write %s.\n", path);
+    free(cdf);
+    free(booked);
+    free(taken);
+    free(rated);
+    return ok;
 }
 
-// Fungsi untuk login user
-void login(hash_table *ht)
+// Satu baris hasil ke layar dan ke file hasil (CSV, satu baris per
+// benchmark per run) supaya bisa dibandingkan antar rilis
+static void bench_result(FILE *results, const char *dataset, hash_table *ht, const char *name, long long n, double ms)
 {
-    char username[20], password[20];
+    double ns = n > 0 ? ms * 1e6 / n : 0.0;
+    printf("%-28s n=%-10lld %10.2f ms %10.1f ns/op\n", name, n, ms, ns);
+    if (results)
+        fprintf(results, "%lld,%s,%d,%d,%s,%lld,%.3f,%.1f\n", (long long)time(NULL), dataset, ht->count,
+                reservation_store.count, name, n, ms, ns);
+}
 
-    printf("Username: ");
-    scanf("%19s", username);
-    getchar();
+// clinic --bench <dir> [results.csv] [repeat]: memuat data di dir (dibuat
+// dengan --gen-data) lewat loader CSV lalu mengukur operasi inti. Setiap
+// benchmark diulang repeat kali dan waktu terbaik yang dicatat. Data di dir
+// tidak diubah
+int run_benchmark(hash_table *ht, const char *dir, const char *results_path, int repeat)
+{
+    if (repeat <= 0)
+        repeat = 3;
+    FILE *results = fopen(results_path, "a");
+    if (!results)
+    {
+        printf("Cannot open %s.\n", results_path);
+        return 1;
+    }
+    if (ftell(results) == 0)
+        fprintf(results, "timestamp,dataset,users,reservations,benchmark,n,total_ms,ns_per_op\n");
+    FILE *null_out = fopen(NULL_DEVICE, "w");
+    if (!null_out || !change_dir(dir))
+    {
+        printf("Cannot open benchmark data in %s.\n", dir);
+        fclose(results);
+        if (null_out)
+            fclose(null_out);
+        return 1;
+    }
 
-    printf("Password: ");
-    scanf("%19s", password);
-    getchar();
+    // Loader CSV seperti startup tanpa clinic.snap, per file parse & merge
+    trie_root = create_trie_node("", 0);
+    CsvLoad users, reservations, rating_totals, ratings;
+    csv_load_start(&users, "users.csv", parse_user_chunk, 0);
+    csv_load_start(&reservations, "reservations.csv", parse_reservation_chunk, 1);
+    csv_load_start(&rating_totals, rating_log.snapshot_path, parse_rating_total_chunk, 1);
+    csv_load_start(&ratings, rating_log.path, parse_rating_chunk, 0);
+    load_users_from_csv(ht, &users);
+    load_reservations_from_csv(ht, &reservations, "reservations.log");
+    load_ratings_from_csv(ht, &rating_totals, &ratings);
+
+    printf("=== Benchmark: %s, %d users, %d reservations, %d doctors ===\n", dir, ht->count,
+           reservation_store.count, doctor_index.count);
+    CsvLoad *loads[] = {&users, &reservations, &rating_totals, &ratings};
+    for (int i = 0; i < 4; i++)
+    {
+        char name[64];
+        snprintf(name, sizeof(name), "parse %s", loads[i]->filename);
+        bench_result(results, dir, ht, name, loads[i]->rows, loads[i]->parse_ms);
+        snprintf(name, sizeof(name), "merge %s", loads[i]->filename);
+        bench_result(results, dir, ht, name, loads[i]->rows, loads[i]->merge_ms);
+    }
 
-    User *u = find_user(ht, username);
-    if (u && strcmp(u->password, password) == 0)
+    // Username yang ada diacak urutannya, miss memakai nama yang tidak ada
+    int names_count = 0;
+    const char **names = (const char **)malloc((ht->count + 1) * sizeof(char *));
+    int *order = (int *)malloc(BENCH_LOOKUPS * sizeof(int));
+    char(*missing)[20] = (char(*)[20])malloc(BENCH_MISSING_NAMES * sizeof(*missing));
+    ReservationNode **items = (ReservationNode **)malloc(BENCH_LOOKUPS * sizeof(ReservationNode *));
+    if (!names || !order || !missing || !items)
     {
-        if (u->role == ROLE_ADMIN)
+        puts("Out of memory.");
+        free(names);
+        free(order);
+        free(missing);
+        free(items);
+        fclose(null_out);
+        fclose(results);
+        return 1;
+    }
+    for (int i = 0; i < ht->capacity; i++)
+        if (ht->slots[i].user)
+            names[names_count++] = ht->slots[i].user->username;
+    uint64_t rng = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+        order[i] = bench_rand_below(&rng, names_count);
+    for (int i = 0; i < BENCH_MISSING_NAMES; i++)
+        sprintf(missing[i], "nobody%d", i);
+
+    // Hari acak untuk count_range diambil dari rentang reservasi yang ada
+    AVLNode *first = avl_select(reservation_store.by_time, 0);
+    AVLNode *last = avl_select(reservation_store.by_time, avl_size(reservation_store.by_time) - 1);
+    int first_day = first ? first->res->when / MINUTES_PER_DAY : 0;
+    int span = last ? last->res->when / MINUTES_PER_DAY - first_day + 1 : 1;
+
+    double best_hit = 0, best_miss = 0, best_insert = 0, best_report = 0, best_top = 0, best_view = 0, best_save = 0,
+           best_count = 0;
+    long long found = 0, report_rows = 0, viewed = 0, counted = 0;
+    for (int run = 0; run < repeat; run++)
+    {
+        double start = now_ms();
+        found = 0;
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+            found += find_user(ht, names[order[i]]) != NULL;
+        double hit = now_ms() - start;
+
+        start = now_ms();
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+            found += find_user(ht, missing[i & (BENCH_MISSING_NAMES - 1)]) != NULL;
+        double miss = now_ms() - start;
+
+        // Reservasi acak ke satu AVL baru (seperti AVL jadwal dokter yang ramai)
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
         {
-            puts("Login successful as ADMIN.");
-            pause_console();
-            admin_menu(ht);
+            items[i] = (ReservationNode *)pool_alloc(&reservation_pool);
+            items[i]->when = days_from_civil(2025, 1, 1) * MINUTES_PER_DAY + bench_rand_below(&rng, 365 * SLOTS_PER_DAY) * SLOT_MINUTES;
+            items[i]->doctor_id = bench_rand_below(&rng, doctor_index.count > 0 ? doctor_index.count : 1);
+            items[i]->patient_id = i;
+            items[i]->snapshot_row = -1;
+            items[i]->notes[0] = '\0';
         }
-        else if (u->role == ROLE_DOCTOR)
+        AVLNode *root = NULL;
+        start = now_ms();
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
         {
-            puts("Login successful as DOCTOR.");
-            pause_console();
-            doctor_menu(u, ht);
+            int inserted;
+            root = insert_avl(root, items[i], AVL_ALLOW_DUPLICATES, &inserted);
         }
-        else
+        double insert = now_ms() - start;
+        free_avl(root);
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+            pool_free(&reservation_pool, items[i]);
+
+        start = now_ms();
+        report_rows = generate_report_with_heap(INT_MIN, INT_MAX, 0, null_out);
+        double report = now_ms() - start;
+
+        start = now_ms();
+        generate_report_with_heap(INT_MIN, INT_MAX, BENCH_REPORT_LIMIT, null_out);
+        double top = now_ms() - start;
+
+        start = now_ms();
+        viewed = 0;
+        for (int d = 0; d < doctor_index.count; d++)
         {
-            puts("Login successful as CLIENT.");
-            pause_console();
-            client_menu(u, ht);
+            view_doctor_appointments(doctor_index.by_id[d]->doctor, null_out);
+            viewed += avl_size(doctor_index.by_id[d]->appointments);
         }
+        double view = now_ms() - start;
+
+        start = now_ms();
+        counted = 0;
+        for (int i = 0; i < BENCH_LOOKUPS; i++)
+        {
+            int from = (first_day + bench_rand_below(&rng, span)) * MINUTES_PER_DAY;
+            counted += avl_count_range(reservation_store.by_time, from, from + MINUTES_PER_DAY - 1);
+        }
+        double count = now_ms() - start;
+
+        start = now_ms();
+        save_reservations_to_csv(ht, "bench_reservations.csv", journal.seq);
+        double save = now_ms() - start;
+        remove("bench_reservations.csv");
+
+        if (run == 0 || hit < best_hit)
+            best_hit = hit;
+        if (run == 0 || miss < best_miss)
+            best_miss = miss;
+        if (run == 0 || insert < best_insert)
+            best_insert = insert;
+        if (run == 0 || report < best_report)
+            best_report = report;
+        if (run == 0 || top < best_top)
+            best_top = top;
+        if (run == 0 || view < best_view)
+            best_view = view;
+        if (run == 0 || save < best_save)
+            best_save = save;
+        if (run == 0 || count < best_count)
+            best_count = count;
     }
-    else
+
+    bench_result(results, dir, ht, "find_user hit", BENCH_LOOKUPS, best_hit);
+    bench_result(results, dir, ht, "find_user miss", BENCH_LOOKUPS, best_miss);
+    bench_result(results, dir, ht, "insert_avl random", BENCH_LOOKUPS, best_insert);
+    bench_result(results, dir, ht, "report all", report_rows, best_report);
+    bench_result(results, dir, ht, "report first 100", BENCH_REPORT_LIMIT, best_top);
+    bench_result(results, dir, ht, "view_doctor_appointments", viewed, best_view);
+    bench_result(results, dir, ht, "save_reservations_to_csv", reservation_store.count, best_save);
+    bench_result(results, dir, ht, "count_range day", BENCH_LOOKUPS, best_count);
+    printf("(count_range found %lld appointments per run)\n", counted); // hasil dipakai, loop tidak dibuang
+
+    free(names);
+    free(order);
+    free(missing);
+    free(items);
+    fclose(null_out);
+    fclose(results);
+    return found == BENCH_LOOKUPS ? 0 : 1; // semua nama yang ada harus ketemu, miss tidak
+}
+
+// ======================= [MAIN FUNCTION] =======================
+
+// Memuat clinic.snap jika masih berlaku: hanya header & dokter yang
+// dibaca, lalu registrasi baru di ujung users.csv, journal dan log rating
+// sejak snapshot ditulis. load berisi statistik untuk report_startup
+static int load_snapshot(hash_table *ht, CsvLoad *load, CsvLoad *users, CsvLoad *ratings, FILE *log)
+{
+    memset(load, 0, sizeof(*load));
+    load->filename = SNAPSHOT_PATH;
+    load->start_ms = now_ms();
+    const char *reason;
+    if (!snapshot_open(ht, &reason))
     {
-        puts("Invalid username or password.");
-        pause_console();
+        if (reason)
+            fprintf(log, "%s ignored (%s), loading CSV files.\n", SNAPSHOT_PATH, reason);
+        return 0;
     }
+    SnapshotHeader h = *snapshot.header; // compaction rating di bawah bisa melepas snapshot
+    load->found = 1;
+    load->rows = h.user_count;
+    load->parse_ms = now_ms() - load->start_ms;
+
+    csv_load_range(users, "users.csv", parse_user_chunk, 0, h.users_csv_size > 0 ? (size_t)h.users_csv_size : 0);
+    csv_load_start(ratings, rating_log.path, parse_rating_chunk, 0);
+    load_users_from_csv(ht, users);
+    double merge_start = now_ms();
+    replay_journal(ht, "reservations.log");
+    journal_open("reservations.csv", "reservations.log");
+    load->merge_ms = now_ms() - merge_start;
+    load_rating_log(ht, ratings, h.rating_seq, 1);
+
+    fprintf(log, "%s: %d users, %d reservations mapped, %d doctors loaded\n", SNAPSHOT_PATH,
+            h.user_count, h.reservation_count, h.doctor_user_count);
+    return 1;
 }
 
-// Fungsi untuk mendaftarkan user baru sebagai client
-void register_client(hash_table *ht)
+// Memuat users/reservations/ratings (semuanya di-parse paralel, lalu
+// digabung berurutan karena reservasi & rating butuh user sudah ada di
+// hash table), kemudian akun bawaan. clinic.snap dipakai jika masih
+// berlaku, jika tidak ditulis ulang setelah CSV dimuat. Bulan yang sudah
+// diarsipkan tidak dimuat (lihat [RESERVATION ARCHIVE]). Statistik startup
+// ditulis ke log
+static void load_clinic_data(hash_table *ht, FILE *log)
 {
-    char username[20], password[20];
-
-    puts("=== Client Registration ===");
-    printf("Choose username: ");
-    scanf("%19s", username);
-    getchar();
+    trie_root = create_trie_node("", 0);
+    archive_load_index(); // cutoff menentukan baris mana yang dimuat
 
-    if (find_user(ht, username))
+    double startup = now_ms();
+    CsvLoad snap, users, reservations, rating_totals, ratings;
+    int mapped = load_snapshot(ht, &snap, &users, &ratings, log);
+    if (mapped)
     {
-        puts("Username already exists.");
-        pause_console();
-        return;
+        CsvLoad *loads[] = {&snap, &users, &ratings};
+        report_startup(loads, 3, now_ms() - startup, log);
     }
+    else
+    {
+        csv_load_start(&users, "users.csv", parse_user_chunk, 0);
+        csv_load_start(&reservations, "reservations.csv", parse_reservation_chunk, 1);
+        csv_load_start(&rating_totals, rating_log.snapshot_path, parse_rating_total_chunk, 1);
+        csv_load_start(&ratings, rating_log.path, parse_rating_chunk, 0);
 
-    printf("Choose password: ");
-    scanf("%19s", password);
-    getchar();
+        load_users_from_csv(ht, &users);
+        load_reservations_from_csv(ht, &reservations, "reservations.log");
+        load_ratings_from_csv(ht, &rating_totals, &ratings);
 
-    insert_user(ht, username, password, ROLE_CLIENT);
+        CsvLoad *loads[] = {&users, &reservations, &rating_totals, &ratings};
+        report_startup(loads, 4, now_ms() - startup, log);
+    }
 
-    save_user_to_csv("users.csv", username, password, ROLE_CLIENT);
-    puts("Registration successful!");
-    pause_console();
+    // Use wrapper to keep hash and Trie in sync
+    insert_user_and_trie(ht, trie_root, "admin", "admin123", ROLE_ADMIN);
+    insert_user_and_trie(ht, trie_root, "drdoom", "dok123", ROLE_DOCTOR);
+    insert_user_and_trie(ht, trie_root, "drstrange", "123dok", ROLE_DOCTOR);
+    insert_user_and_trie(ht, trie_root, "alice", "1234", ROLE_CLIENT);
+
+    if (archive_due())
+        compact_journal(ht); // bulan baru: bulan lalu pindah ke arsip
+    else if (!mapped)
+        save_snapshot(ht); // startup berikutnya tidak perlu parse CSV
+    persistence_start(ht);
 }
 
-// ======================= [MAIN FUNCTION] =======================
-int main()
+int main(int argc, char **argv)
 {
-    hash_table ht = {0};
-    trie_root = create_trie_node();
+    if (argc > 1 && strcmp(argv[1], "--bench-avl") == 0)
+        return run_avl_benchmark(argc > 2 ? atoi(argv[2]) : 0);
+    if (argc > 1 && strcmp(argv[1], "--bench-csv") == 0)
+        return run_csv_benchmark(argc > 2 ? atoi(argv[2]) : 0);
 
-    load_users_from_csv(&ht, "users.csv");
-    load_reservations_from_csv(&ht, "reservations.csv");
-    load_ratings_from_csv(&ht, "ratings.csv");
+    init_locks();
+    hash_table ht = {0};
+    if (argc > 1 && strcmp(argv[1], "--gen-data") == 0)
+    {
+        const char *dir = argc > 2 ? argv[2] : "bench_data";
+        if (!generate_bench_data(dir, argc > 3 ? atoi(argv[3]) : 0, argc > 4 ? atoi(argv[4]) : -1,
+                                 argc > 5 ? atoi(argv[5]) : -1, argc > 6 ? (unsigned int)atoi(argv[6]) : 1) ||
+            !change_dir(dir))
+            return 1;
+        load_clinic_data(&ht, stdout); // startup pertama menulis rating_totals.csv & clinic.snap
+        persistence_stop();
+        return 0;
+    }
+    if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+        return run_benchmark(&ht, argc > 2 ? argv[2] : "bench_data", argc > 3 ? argv[3] : BENCH_RESULTS_PATH,
+                             argc > 4 ? atoi(argv[4]) : 0);
+    if (argc > 1 && strcmp(argv[1], "--serve") == 0)
+    {
+        load_clinic_data(&ht, stderr);
+        return run_server(&ht, argc > 2 ? atoi(argv[2]) : 0, argc > 3 ? atoi(argv[3]) : 0);
+    }
+    if (argc > 1 && strcmp(argv[1], "--batch") == 0)
+    {
+        load_clinic_data(&ht, stderr);
+        int status = run_batch(&ht, argc > 2 ? argv[2] : "requests.jsonl", argc > 3 ? argv[3] : NULL);
+        persistence_stop();
+        return status;
+    }
 
-    // Use wrapper to keep hash and Trie in sync
-    insert_user_and_trie(&ht, trie_root, "admin", "admin123", ROLE_ADMIN);
-    insert_user_and_trie(&ht, trie_root, "drdoom", "dok123", ROLE_DOCTOR);
-    insert_user_and_trie(&ht, trie_root, "drstrange", "123dok", ROLE_DOCTOR);
-    insert_user_and_trie(&ht, trie_root, "alice", "1234", ROLE_CLIENT);
+    load_clinic_data(&ht, stdout);
 
     int choice;
     do
     {
-        system("cls");
+        term_clear();
         puts("=== Clinic System ===");
         puts("1. Register (Client)");
         puts("2. Login");
@@ -1277,12 +8083,15 @@ int main()
         switch (choice)
         {
         case 1:
+            rwlock_read_lock(&table_lock); // lihat admin_menu
             register_client(&ht);
+            rwlock_read_unlock(&table_lock);
             break;
         case 2:
             login(&ht);
             break;
         case 0:
+            persistence_stop();
             puts("Goodbye!");
             break;
         default: